@@ -3,17 +3,39 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
-#include <sys/mman.h>
-#include <fcntl.h>
-#include <unistd.h>
-#include "xdg-shell-client-header.h"
+#include <signal.h>
+#include <time.h>
+#include "xdg-shell-client-protocol.h"
+#include "event-loop.h"
+#include "latency-stats.h"
+#include "log.h"
+#include "renderer.h"
+#include "shm-format.h"
+#include "shm-pool.h"
+#include "solid-surface.h"
+#include "tile-render.h"
+#include "trace.h"
+
+// How the child is shown: as its own toplevel tied to the parent with
+// xdg_toplevel_set_parent, or as a subsurface composited inside it.
+enum mode {
+    MODE_TOPLEVEL,
+    MODE_SUBSURFACE,
+};
+
+static const char *const mode_names[] = {"toplevel", "subsurface"};
 
 struct state {
     struct wl_display *display;
     struct wl_registry *registry;
     struct wl_compositor *compositor;
+    struct wl_subcompositor *subcompositor;
     struct wl_shm *shm;
     struct xdg_wm_base *wm_base;
+    struct wp_viewporter *viewporter;
+    struct wp_single_pixel_buffer_manager_v1 *single_pixel;
+    struct event_loop loop;
+    enum mode mode;
 
     struct wl_surface *parent_surface;
     struct wl_surface *child_surface;
@@ -21,83 +43,181 @@ struct state {
     struct xdg_toplevel *parent_toplevel;
     struct xdg_surface *child_xdg_surface;
     struct xdg_toplevel *child_toplevel;
-
-    struct wl_buffer *parent_buffer;
-    struct wl_buffer *child_buffer;
-    uint32_t *parent_shm_data;
-    uint32_t *child_shm_data;
+    struct wl_subsurface *child_subsurface;
+    int parent_configured, child_configured;
+
+    struct shm_pool parent_pool;
+    struct shm_pool child_pool;
+    struct solid_surface parent_solid;
+    struct solid_surface child_solid;
+    struct renderer *renderer;
     int parent_width, parent_height;
     int child_width, child_height;
+    uint32_t child_color;
+
+    // Scripted run for benchmarking the two modes, see main(). A step
+    // ends when the frame callbacks of every surface it committed are
+    // done, i.e. the compositor has shown the new contents.
+    struct event_source *script_timer;
+    int script_steps;
+    int script_interval_ms;
+    int script_step;
+    int frames_pending;
+    uint64_t step_ns;
+    int step_resized;
+    struct latency_stats resize_latency;
+    struct latency_stats update_latency;
 };
 
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
 
 
-static int create_shm_file(size_t size) {
-    char name[8];
-    name[0] = '/';
-    name[7] = '\0';
-    for (int i = 1; i < 7; i++) {
-        name[i] = 'a' + (rand() % 26); 
-    }
-    int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
-    shm_unlink(name);
-    if (fd < 0) {
-        perror("shm_open");
+static void xdg_wm_base_ping(void *data, struct xdg_wm_base *wm_base, uint32_t serial) {
+    xdg_wm_base_pong(wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener wm_base_listener = {
+    .ping = xdg_wm_base_ping,
+};
+
+static int draw_parent(struct state *state) {
+    // Fill a free parent buffer with blue
+    if (solid_surface_update(&state->parent_solid, state->parent_width, state->parent_height, 0xFF0000FF) < 0) {
+        log_warn("No free parent buffer");
         return -1;
     }
+    return 0;
+}
 
-    if (ftruncate(fd, size) < 0) {
-        perror("ftruncate");
-        close(fd);
+static int draw_child(struct state *state) {
+    // Fill a free child buffer with green
+    if (solid_surface_update(&state->child_solid, state->child_width, state->child_height, state->child_color) < 0) {
+        log_warn("No free child buffer");
         return -1;
     }
-    return fd;
+    if (state->child_subsurface) {
+        // keep the child centred; like the buffer this is applied on the
+        // parent's next commit
+        wl_subsurface_set_position(state->child_subsurface,
+                                   (state->parent_width - state->child_width) / 2,
+                                   (state->parent_height - state->child_height) / 2);
+    }
+    return 0;
 }
 
-static struct wl_buffer *create_buffer(struct state *state, int width, int height, uint32_t **data_out) {
-    int stride = width * 4;
-    int size = stride * height;
-    int fd = create_shm_file(size);
-    if (fd < 0) return NULL;
+static void commit(struct wl_surface *surface) {
+    TRACE_BEGIN("wl_surface_commit");
+    wl_surface_commit(surface);
+    TRACE_END("wl_surface_commit");
+}
 
-    uint32_t *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    if (data == MAP_FAILED) {
-        close(fd);
-        return NULL;
+static void frame_done(void *data, struct wl_callback *callback, uint32_t time) {
+    struct state *state = data;
+    wl_callback_destroy(callback);
+    if (--state->frames_pending == 0 && state->step_ns) {
+        uint64_t latency = now_ns() - state->step_ns;
+        latency_stats_add(state->step_resized ? &state->resize_latency : &state->update_latency, latency);
+        state->step_ns = 0;
     }
-    struct wl_shm_pool *pool = wl_shm_create_pool(state->shm, fd, size);
-    struct wl_buffer *buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride, WL_SHM_FORMAT_ARGB8888);
-    wl_shm_pool_destroy(pool);
-    close(fd);
+}
 
-    // Fill with color (parent: blue, child: green)
-    uint32_t color = (width == state->parent_width && height == state->parent_height) ? 0xFF0000FF : 0xFF00FF00;
-    for (int i = 0; i < width * height; ++i) data[i] = color;
+static const struct wl_callback_listener frame_listener = {
+    .done = frame_done,
+};
 
-    if (data_out) *data_out = data;
-    return buffer;
+static void request_frame(struct state *state, struct wl_surface *surface) {
+    struct wl_callback *callback = wl_surface_frame(surface);
+    wl_callback_add_listener(callback, &frame_listener, state);
+    state->frames_pending++;
 }
 
-static void xdg_wm_base_ping(void *data, struct xdg_wm_base *wm_base, uint32_t serial) {
-    xdg_wm_base_pong(wm_base, serial);
+// Resizes the parent on three steps out of four and recolours only the
+// child on the fourth.
+static void script_step_func(void *data, uint32_t expirations) {
+    struct state *state = data;
+    if (state->frames_pending) {
+        // the previous step is not on screen yet
+        return;
+    }
+    if (state->script_step++ == state->script_steps) {
+        event_loop_quit(&state->loop);
+        return;
+    }
+
+    TRACE_BEGIN("script_step");
+    state->step_ns = now_ns();
+    state->step_resized = state->script_step % 4 != 0;
+    if (!state->step_resized) {
+        state->child_color ^= 0x00FF0000;
+        // desync lets a child-only update through without a parent commit
+        if (state->child_subsurface) {
+            wl_subsurface_set_desync(state->child_subsurface);
+        }
+        draw_child(state);
+        request_frame(state, state->child_surface);
+        commit(state->child_surface);
+        if (state->child_subsurface) {
+            wl_subsurface_set_sync(state->child_subsurface);
+        }
+        TRACE_END("script_step");
+        return;
+    }
+
+    state->parent_width = 400 + (state->script_step * 37) % 400;
+    state->parent_height = 400 + (state->script_step * 53) % 400;
+    state->child_width = state->parent_width / 2;
+    state->child_height = state->parent_height / 2;
+    if (state->child_subsurface) {
+        // In sync mode the child commit is cached and lands together with
+        // the parent's, so both change size in the same frame.
+        draw_child(state);
+        commit(state->child_surface);
+        draw_parent(state);
+        request_frame(state, state->parent_surface);
+        commit(state->parent_surface);
+    } else {
+        draw_parent(state);
+        request_frame(state, state->parent_surface);
+        commit(state->parent_surface);
+        draw_child(state);
+        request_frame(state, state->child_surface);
+        commit(state->child_surface);
+    }
+    TRACE_END("script_step");
 }
 
-static const struct xdg_wm_base_listener wm_base_listener = {
-    .ping = xdg_wm_base_ping,
-};
+static void maybe_start_script(struct state *state) {
+    if (!state->script_steps || state->script_timer || !state->parent_configured ||
+        (state->mode == MODE_TOPLEVEL && !state->child_configured)) {
+        return;
+    }
+    state->script_timer = event_loop_add_timer(&state->loop, script_step_func, state);
+    event_source_timer_update(state->script_timer, state->script_interval_ms,
+                              state->script_interval_ms);
+}
 
 static void parent_xdg_surface_configure(void *data, struct xdg_surface *surface, uint32_t serial) {
     struct state *state = data;
+    TRACE_BEGIN("parent_configure");
     xdg_surface_ack_configure(surface, serial);
 
-    // Recreate parent buffer
-    if (state->parent_buffer) wl_buffer_destroy(state->parent_buffer);
-    state->parent_buffer = create_buffer(state, state->parent_width, state->parent_height, &state->parent_shm_data);
-    wl_surface_attach(state->parent_surface, state->parent_buffer, 0, 0);
-    wl_surface_damage_buffer(state->parent_surface, 0, 0, state->parent_width, state->parent_height);
-    wl_surface_commit(state->parent_surface);
-
-    
+    if (state->child_subsurface) {
+        // the child's first buffer is cached until the parent commits
+        draw_child(state);
+        commit(state->child_surface);
+    }
+    if (draw_parent(state) < 0) {
+        TRACE_END("parent_configure");
+        return;
+    }
+    commit(state->parent_surface);
+    state->parent_configured = 1;
+    maybe_start_script(state);
+    TRACE_END("parent_configure");
 }
 
 static const struct xdg_surface_listener parent_xdg_surface_listener = {
@@ -105,18 +225,21 @@ static const struct xdg_surface_listener parent_xdg_surface_listener = {
 };
 
 static void child_xdg_surface_configure(void *data, struct xdg_surface *surface, uint32_t serial) {
+    TRACE_BEGIN("child_configure");
     xdg_surface_ack_configure(surface, serial);
     struct state *state = data;
     // Resize child to match parent (for demonstration)
     state->child_width = state->parent_width / 2;
     state->child_height = state->parent_height / 2;
 
-    // // Recreate child buffer
-    if (state->child_buffer) wl_buffer_destroy(state->child_buffer);
-    state->child_buffer = create_buffer(state, state->child_width, state->child_height, &state->child_shm_data);
-    wl_surface_attach(state->child_surface, state->child_buffer, 0, 0);
-    wl_surface_damage_buffer(state->child_surface, 0, 0, state->child_width, state->child_height);
-    wl_surface_commit(state->child_surface);
+    if (draw_child(state) < 0) {
+        TRACE_END("child_configure");
+        return;
+    }
+    commit(state->child_surface);
+    state->child_configured = 1;
+    maybe_start_script(state);
+    TRACE_END("child_configure");
 }
 
 static const struct xdg_surface_listener child_xdg_surface_listener = {
@@ -128,11 +251,20 @@ static void registry_global(void *data, struct wl_registry *registry,
     struct state *state = data;
     if (strcmp(interface, wl_compositor_interface.name) == 0) {
         state->compositor = wl_registry_bind(registry, name, &wl_compositor_interface, 4);
+    } else if (strcmp(interface, wl_subcompositor_interface.name) == 0) {
+        state->subcompositor = wl_registry_bind(registry, name, &wl_subcompositor_interface, 1);
     } else if (strcmp(interface, wl_shm_interface.name) == 0) {
         state->shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+        shm_format_listen(state->shm);
     } else if (strcmp(interface, xdg_wm_base_interface.name) == 0) {
         state->wm_base = wl_registry_bind(registry, name, &xdg_wm_base_interface, 1);
         xdg_wm_base_add_listener(state->wm_base, &wm_base_listener, state);
+    } else if (strcmp(interface, wp_viewporter_interface.name) == 0) {
+        state->viewporter = wl_registry_bind(registry, name, &wp_viewporter_interface, 1);
+#ifdef DEMOS_HAVE_SINGLE_PIXEL_BUFFER
+    } else if (strcmp(interface, wp_single_pixel_buffer_manager_v1_interface.name) == 0) {
+        state->single_pixel = wl_registry_bind(registry, name, &wp_single_pixel_buffer_manager_v1_interface, 1);
+#endif
     }
 }
 
@@ -143,12 +275,46 @@ static const struct wl_registry_listener registry_listener = {
     .global_remove = registry_global_remove,
 };
 
-int main() {
+static void handle_signal(void *data, uint32_t sig) {
+    struct state *state = data;
+    event_loop_quit(&state->loop);
+}
+
+// Usage: attach-two-surfaces [toplevel|subsurface [steps [interval_ms]]]
+// With a step count the parent is resized (and the child recoloured) on
+// its own every interval_ms (default 4) and the demo exits after that
+// many steps, printing how long each kind of step took to reach the
+// screen.
+int main(int argc, char **argv) {
     struct state state = {0};
+    if (argc > 1) {
+        if (!strcmp(argv[1], mode_names[MODE_SUBSURFACE])) {
+            state.mode = MODE_SUBSURFACE;
+        } else if (strcmp(argv[1], mode_names[MODE_TOPLEVEL])) {
+            fprintf(stderr, "Usage: %s [toplevel|subsurface [steps [interval_ms]]]\n", argv[0]);
+            return 1;
+        }
+    }
+    state.script_steps = argc > 2 ? atoi(argv[2]) : 0;
+    state.script_interval_ms = argc > 3 ? atoi(argv[3]) : 4;
+    if (state.script_steps < 0 || state.script_interval_ms <= 0) {
+        fprintf(stderr, "Usage: %s [toplevel|subsurface [steps [interval_ms]]]\n", argv[0]);
+        return 1;
+    }
+    latency_stats_init(&state.resize_latency);
+    latency_stats_init(&state.update_latency);
+    log_init();
+    TRACE_INIT();
+    tile_render_init(0);
+    state.renderer = renderer_create(NULL);
+    if (!state.renderer) {
+        return 1;
+    }
     state.parent_width = 400;
     state.parent_height = 400;
     state.child_width = 200;
     state.child_height = 200;
+    state.child_color = 0xFF00FF00;
 
     state.display = wl_display_connect(NULL);
     if (!state.display) {
@@ -159,10 +325,20 @@ int main() {
     wl_registry_add_listener(state.registry, &registry_listener, &state);
     wl_display_roundtrip(state.display);
 
-    if (!state.compositor || !state.shm || !state.wm_base) {
+    if (!state.compositor || !state.shm || !state.wm_base ||
+        (state.mode == MODE_SUBSURFACE && !state.subcompositor)) {
         fprintf(stderr, "Missing required globals\n");
         return 1;
     }
+    shm_pool_init(&state.parent_pool, state.shm, 3);
+    shm_pool_init(&state.child_pool, state.shm, 3);
+    if (event_loop_init(&state.loop, state.display, NULL) < 0) {
+        return 1;
+    }
+    struct event_source *sigint =
+        event_loop_add_signal(&state.loop, SIGINT, handle_signal, &state);
+    struct event_source *sigterm =
+        event_loop_add_signal(&state.loop, SIGTERM, handle_signal, &state);
 
     // Parent surface
     state.parent_surface = wl_compositor_create_surface(state.compositor);
@@ -171,27 +347,73 @@ int main() {
     state.parent_toplevel = xdg_surface_get_toplevel(state.parent_xdg_surface);
     xdg_toplevel_set_title(state.parent_toplevel, "Parent");
     xdg_toplevel_set_app_id(state.parent_toplevel, "parent");
+    solid_surface_init(&state.parent_solid, state.compositor, state.parent_surface, &state.parent_pool, state.renderer, state.viewporter, state.single_pixel);
 
     // Child surface
     state.child_surface = wl_compositor_create_surface(state.compositor);
-    state.child_xdg_surface = xdg_wm_base_get_xdg_surface(state.wm_base, state.child_surface);
-    xdg_surface_add_listener(state.child_xdg_surface, &child_xdg_surface_listener, &state);
-    state.child_toplevel = xdg_surface_get_toplevel(state.child_xdg_surface);
-    xdg_toplevel_set_title(state.child_toplevel, "Child");
-    xdg_toplevel_set_app_id(state.child_toplevel, "child");
-
-    // // Set child as a subsurface of parent (for stacking, not parenting in xdg-shell)
-    // // For true parent-child in xdg-shell, use xdg_toplevel_set_parent:
-    xdg_toplevel_set_parent(state.child_toplevel, state.parent_toplevel);
+    solid_surface_init(&state.child_solid, state.compositor, state.child_surface, &state.child_pool, state.renderer, state.viewporter, state.single_pixel);
+    if (state.mode == MODE_SUBSURFACE) {
+        // Subsurfaces start out synchronized: their commits are cached and
+        // applied together with the parent's next commit.
+        state.child_subsurface = wl_subcompositor_get_subsurface(state.subcompositor, state.child_surface, state.parent_surface);
+    } else {
+        state.child_xdg_surface = xdg_wm_base_get_xdg_surface(state.wm_base, state.child_surface);
+        xdg_surface_add_listener(state.child_xdg_surface, &child_xdg_surface_listener, &state);
+        state.child_toplevel = xdg_surface_get_toplevel(state.child_xdg_surface);
+        xdg_toplevel_set_title(state.child_toplevel, "Child");
+        xdg_toplevel_set_app_id(state.child_toplevel, "child");
+        // For true parent-child in xdg-shell, use xdg_toplevel_set_parent
+        xdg_toplevel_set_parent(state.child_toplevel, state.parent_toplevel);
+        wl_surface_commit(state.child_surface);
+    }
 
     wl_surface_commit(state.parent_surface);
-    wl_display_roundtrip(state.display);
-    // wl_surface_commit(state.child_surface);
-    // wl_display_roundtrip(state.display);
 
-    // Enter event loop
-    while (wl_display_dispatch(state.display) != -1) {}
+    event_loop_run(&state.loop);
+    if (state.script_timer) {
+        event_source_remove(state.script_timer);
+    }
+    event_source_remove(sigint);
+    event_source_remove(sigterm);
+    event_loop_finish(&state.loop);
+
+    if (state.script_steps) {
+        char label[32];
+        snprintf(label, sizeof(label), "%s-resize", mode_names[state.mode]);
+        latency_stats_print(&state.resize_latency, stdout, label);
+        snprintf(label, sizeof(label), "%s-update", mode_names[state.mode]);
+        latency_stats_print(&state.update_latency, stdout, label);
+    }
+    latency_stats_finish(&state.resize_latency);
+    latency_stats_finish(&state.update_latency);
 
+    if (state.child_subsurface) {
+        wl_subsurface_destroy(state.child_subsurface);
+    }
+    if (state.child_toplevel) {
+        xdg_toplevel_destroy(state.child_toplevel);
+        xdg_surface_destroy(state.child_xdg_surface);
+    }
+    solid_surface_finish(&state.child_solid);
+    wl_surface_destroy(state.child_surface);
+    xdg_toplevel_destroy(state.parent_toplevel);
+    xdg_surface_destroy(state.parent_xdg_surface);
+    solid_surface_finish(&state.parent_solid);
+    wl_surface_destroy(state.parent_surface);
+    shm_pool_finish(&state.child_pool);
+    shm_pool_finish(&state.parent_pool);
+    if (state.viewporter) {
+        wp_viewporter_destroy(state.viewporter);
+    }
+#ifdef DEMOS_HAVE_SINGLE_PIXEL_BUFFER
+    if (state.single_pixel) {
+        wp_single_pixel_buffer_manager_v1_destroy(state.single_pixel);
+    }
+#endif
     wl_display_disconnect(state.display);
+    renderer_destroy(state.renderer);
+    tile_render_finish();
+    TRACE_FINISH();
+    log_finish();
     return 0;
-}
\ No newline at end of file
+}
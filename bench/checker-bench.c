@@ -0,0 +1,116 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pattern-fill.h"
+
+// Compares pattern_fill_checker() against the column-major loop that
+// draw_chess_board() used to run in xdg-foreign/exporter.c.
+
+struct size {
+    const char *name;
+    int width, height;
+};
+
+static const struct size sizes[] = {
+    {"500x500", 500, 500},
+    {"1080p", 1920, 1080},
+    {"4K", 3840, 2160},
+};
+
+static const struct {
+    enum pattern_fill_isa isa;
+    const char *name;
+} kernels[] = {
+    {PATTERN_FILL_SCALAR, "scalar"},
+    {PATTERN_FILL_SSE2, "sse2"},
+    {PATTERN_FILL_AVX2, "avx2"},
+};
+
+static uint32_t first_color = 0xFF666666;
+static uint32_t second_color = 0xFFEEEEEE;
+
+static void draw_chess_board_reference(uint32_t *pixels, int width,
+                                       int height) {
+    for (int x = 0; x < width; x++) {
+        for (int y = 0; y < height; y++) {
+            if ((x + y / 8 * 8) % 16 < 8) {
+                pixels[y * width + x] = first_color;
+            } else {
+                pixels[y * width + x] = second_color;
+            }
+        }
+    }
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Run fill for roughly half a second and return the mean time per frame.
+#define TIME_FRAMES(ms_out, stmt)                                   \
+    do {                                                            \
+        int frames = 0;                                             \
+        double start = now_ms(), elapsed;                           \
+        do {                                                        \
+            stmt;                                                   \
+            frames++;                                               \
+            elapsed = now_ms() - start;                             \
+        } while (elapsed < 500.0);                                  \
+        ms_out = elapsed / frames;                                  \
+    } while (0)
+
+int main(void) {
+    pattern_fill_set_isa(PATTERN_FILL_AUTO);
+    printf("auto picks %s\n", pattern_fill_isa_name());
+    printf("%-8s %-8s %10s %10s %8s\n", "size", "kernel", "ms/frame",
+           "GB/s", "speedup");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int width = sizes[s].width;
+        int height = sizes[s].height;
+        size_t bytes = (size_t)width * height * 4;
+        uint32_t *expected = malloc(bytes);
+        uint32_t *pixels = malloc(bytes);
+        if (!expected || !pixels) {
+            perror("malloc");
+            return 1;
+        }
+
+        double reference;
+        TIME_FRAMES(reference,
+                    draw_chess_board_reference(expected, width, height));
+        printf("%-8s %-8s %10.3f %10.2f %8s\n", sizes[s].name, "loop",
+               reference, bytes / reference / 1e6, "1.00x");
+
+        for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+            if (pattern_fill_set_isa(kernels[k].isa) < 0) {
+                printf("%-8s %-8s %10s\n", sizes[s].name, kernels[k].name,
+                       "n/a");
+                continue;
+            }
+
+            memset(pixels, 0, bytes);
+            double ms;
+            TIME_FRAMES(ms, pattern_fill_checker(pixels, width, 0, 0, width,
+                                                 height, first_color,
+                                                 second_color));
+            if (memcmp(pixels, expected, bytes) != 0) {
+                fprintf(stderr, "%s output differs from the reference\n",
+                        kernels[k].name);
+                return 1;
+            }
+            printf("%-8s %-8s %10.3f %10.2f %7.2fx\n", sizes[s].name,
+                   kernels[k].name, ms, bytes / ms / 1e6, reference / ms);
+        }
+
+        free(expected);
+        free(pixels);
+    }
+    return 0;
+}
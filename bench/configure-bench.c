@@ -0,0 +1,291 @@
+#define _POSIX_C_SOURCE 200809L
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wayland-client.h>
+
+#include "xdg-foreign-unstable-v2-client-protocol.h"
+#include "xdg-shell-client-protocol.h"
+#include "mock-compositor.h"
+#include "pattern-fill.h"
+#include "shm-pool.h"
+
+// Client-side cost of registry binding and of handling a configure
+// (ack, buffer acquisition, fill, attach, commit), measured against the
+// in-process mock compositor so no real compositor adds noise. The time
+// the mock spends is subtracted from every figure.
+//
+// Usage: configure-bench [configures [burst]]
+// burst configures are injected before the client gets to run, standing
+// in for a compositor that sends them faster than the client keeps up.
+
+#define BIND_ITERATIONS 200
+
+struct client {
+    struct wl_display *display;
+    struct wl_registry *registry;
+    struct wl_compositor *compositor;
+    struct wl_shm *shm;
+    struct xdg_wm_base *wm_base;
+    struct zxdg_exporter_v2 *exporter;
+    struct zxdg_importer_v2 *importer;
+
+    struct wl_surface *surface;
+    struct xdg_surface *xdg_surface;
+    struct xdg_toplevel *toplevel;
+    struct shm_pool pool;
+    int width, height;
+    unsigned long configures;
+    unsigned long dropped;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void xdg_wm_base_ping(void *data, struct xdg_wm_base *wm_base,
+                             uint32_t serial) {
+    xdg_wm_base_pong(wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener wm_base_listener = {
+    .ping = xdg_wm_base_ping,
+};
+
+static void registry_global(void *data, struct wl_registry *registry,
+                            uint32_t name, const char *interface,
+                            uint32_t version) {
+    struct client *client = data;
+    if (!strcmp(interface, wl_compositor_interface.name)) {
+        client->compositor =
+            wl_registry_bind(registry, name, &wl_compositor_interface, 4);
+    } else if (!strcmp(interface, wl_shm_interface.name)) {
+        client->shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+    } else if (!strcmp(interface, xdg_wm_base_interface.name)) {
+        client->wm_base =
+            wl_registry_bind(registry, name, &xdg_wm_base_interface, 1);
+        xdg_wm_base_add_listener(client->wm_base, &wm_base_listener, NULL);
+    } else if (!strcmp(interface, zxdg_exporter_v2_interface.name)) {
+        client->exporter =
+            wl_registry_bind(registry, name, &zxdg_exporter_v2_interface, 1);
+    } else if (!strcmp(interface, zxdg_importer_v2_interface.name)) {
+        client->importer =
+            wl_registry_bind(registry, name, &zxdg_importer_v2_interface, 1);
+    }
+}
+
+static void registry_global_remove(void *data, struct wl_registry *registry,
+                                   uint32_t name) {}
+
+static const struct wl_registry_listener registry_listener = {
+    .global = registry_global,
+    .global_remove = registry_global_remove,
+};
+
+static void xdg_surface_configure(void *data, struct xdg_surface *xdg_surface,
+                                  uint32_t serial) {
+    struct client *client = data;
+    xdg_surface_ack_configure(xdg_surface, serial);
+    client->configures++;
+
+    struct shm_slot *slot =
+        shm_pool_acquire(&client->pool, client->width, client->height);
+    if (!slot) {
+        // every buffer is still with the compositor
+        client->dropped++;
+        return;
+    }
+    pattern_fill_checker(slot->data, slot->stride / 4, 0, 0, slot->width,
+                         slot->height, 0xFF666666, 0xFFEEEEEE);
+    wl_surface_attach(client->surface, slot->buffer, 0, 0);
+    wl_surface_damage_buffer(client->surface, 0, 0, slot->width,
+                             slot->height);
+    wl_surface_commit(client->surface);
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+    .configure = xdg_surface_configure,
+};
+
+static void xdg_toplevel_configure(void *data, struct xdg_toplevel *toplevel,
+                                   int32_t width, int32_t height,
+                                   struct wl_array *states) {
+    struct client *client = data;
+    if (width > 0 && height > 0) {
+        client->width = width;
+        client->height = height;
+    }
+}
+
+static void xdg_toplevel_close(void *data, struct xdg_toplevel *toplevel) {}
+
+static const struct xdg_toplevel_listener toplevel_listener = {
+    .configure = xdg_toplevel_configure,
+    .close = xdg_toplevel_close,
+};
+
+// Lets both ends talk until neither has anything left to say. Everything
+// runs on this thread, so the order of events is the same on every run.
+static void pump(struct client *client, struct mock_compositor *mock) {
+    int fd = wl_display_get_fd(client->display);
+    for (;;) {
+        wl_display_flush(client->display);
+        mock_compositor_dispatch(mock);
+        while (wl_display_prepare_read(client->display) != 0) {
+            wl_display_dispatch_pending(client->display);
+        }
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        if (poll(&pfd, 1, 0) <= 0) {
+            wl_display_cancel_read(client->display);
+            return;
+        }
+        wl_display_read_events(client->display);
+        wl_display_dispatch_pending(client->display);
+    }
+}
+
+static int client_connect(struct client *client, struct mock_compositor *mock,
+                          int fd) {
+    memset(client, 0, sizeof(*client));
+    client->display = wl_display_connect_to_fd(fd);
+    if (!client->display) {
+        fprintf(stderr, "Failed to connect to the mock compositor\n");
+        return -1;
+    }
+    client->registry = wl_display_get_registry(client->display);
+    wl_registry_add_listener(client->registry, &registry_listener, client);
+    pump(client, mock);
+    if (!client->compositor || !client->shm || !client->wm_base) {
+        fprintf(stderr, "Missing required globals\n");
+        return -1;
+    }
+    return 0;
+}
+
+static void client_disconnect(struct client *client) {
+    if (client->toplevel) {
+        xdg_toplevel_destroy(client->toplevel);
+        xdg_surface_destroy(client->xdg_surface);
+        wl_surface_destroy(client->surface);
+        shm_pool_finish(&client->pool);
+    }
+    if (client->exporter) {
+        zxdg_exporter_v2_destroy(client->exporter);
+    }
+    if (client->importer) {
+        zxdg_importer_v2_destroy(client->importer);
+    }
+    xdg_wm_base_destroy(client->wm_base);
+    wl_shm_destroy(client->shm);
+    wl_compositor_destroy(client->compositor);
+    wl_registry_destroy(client->registry);
+    wl_display_disconnect(client->display);
+}
+
+static void print_counts(struct mock_compositor *mock, unsigned long events) {
+    const struct mock_request_count *counts;
+    int n = mock_compositor_request_counts(mock, &counts);
+    for (int i = 0; i < n; i++) {
+        printf("    %s.%s %.2f\n", counts[i].interface, counts[i].message,
+               (double)counts[i].count / events);
+    }
+}
+
+static void bench_bind(void) {
+    uint64_t client_ns = 0;
+    struct mock_compositor *mock = NULL;
+    for (int i = 0; i < BIND_ITERATIONS; i++) {
+        int fd;
+        mock = mock_compositor_create(&fd);
+        if (!mock) {
+            exit(1);
+        }
+        struct client client;
+        uint64_t start = now_ns();
+        if (client_connect(&client, mock, fd) < 0) {
+            exit(1);
+        }
+        client_ns += now_ns() - start - mock_compositor_time_ns(mock);
+        client_disconnect(&client);
+        if (i < BIND_ITERATIONS - 1) {
+            mock_compositor_destroy(mock);
+        }
+    }
+    printf("bind: %.1fus per connection, %.1f requests\n",
+           client_ns / 1e3 / BIND_ITERATIONS,
+           (double)mock_compositor_requests(mock));
+    mock_compositor_destroy(mock);
+}
+
+static void bench_configure(struct client *client,
+                            struct mock_compositor *mock, const char *name,
+                            int configures, int burst, int resize) {
+    mock_compositor_reset_counts(mock);
+    client->configures = 0;
+    client->dropped = 0;
+
+    uint64_t start = now_ns();
+    for (int sent = 0; sent < configures;) {
+        for (int i = 0; i < burst && sent < configures; i++, sent++) {
+            int width = 256, height = 256;
+            if (resize) {
+                width = 200 + (sent * 37) % 200;
+                height = 200 + (sent * 53) % 200;
+            }
+            mock_compositor_configure(mock, width, height);
+        }
+        pump(client, mock);
+    }
+    uint64_t total = now_ns() - start;
+    uint64_t server = mock_compositor_time_ns(mock);
+
+    printf("%s: %.2fus client, %.2fus mock per configure, "
+           "%.2f requests, %lu dropped\n",
+           name, (total - server) / 1e3 / client->configures,
+           server / 1e3 / client->configures,
+           (double)mock_compositor_requests(mock) / client->configures,
+           client->dropped);
+    print_counts(mock, client->configures);
+}
+
+int main(int argc, char **argv) {
+    int configures = argc > 1 ? atoi(argv[1]) : 10000;
+    int burst = argc > 2 ? atoi(argv[2]) : 1;
+    if (configures <= 0 || burst <= 0) {
+        fprintf(stderr, "Usage: %s [configures [burst]]\n", argv[0]);
+        return 1;
+    }
+
+    bench_bind();
+
+    int fd;
+    struct mock_compositor *mock = mock_compositor_create(&fd);
+    struct client client;
+    if (!mock || client_connect(&client, mock, fd) < 0) {
+        return 1;
+    }
+    shm_pool_init(&client.pool, client.shm, 3);
+    client.width = 256;
+    client.height = 256;
+    client.surface = wl_compositor_create_surface(client.compositor);
+    client.xdg_surface =
+        xdg_wm_base_get_xdg_surface(client.wm_base, client.surface);
+    xdg_surface_add_listener(client.xdg_surface, &xdg_surface_listener,
+                             &client);
+    client.toplevel = xdg_surface_get_toplevel(client.xdg_surface);
+    xdg_toplevel_add_listener(client.toplevel, &toplevel_listener, &client);
+    wl_surface_commit(client.surface);
+    pump(&client, mock);
+
+    bench_configure(&client, mock, "configure", configures, burst, 0);
+    bench_configure(&client, mock, "resize", configures, burst, 1);
+
+    client_disconnect(&client);
+    mock_compositor_destroy(mock);
+    return 0;
+}
@@ -0,0 +1,20 @@
+#!/bin/bash
+# Resize fan-out latency: starts a headless weston and has one controller
+# broadcast scripted sizes to a group of 1..64 follower windows. For each
+# group size it prints the follower's latency and frame lines and its
+# measurement line. Uses the binaries in $BUILD (default: build/).
+
+RESIZES=${RESIZES:-500}
+INTERVAL_MS=${INTERVAL_MS:-16}
+
+. "$(dirname "$0")/headless.sh"
+headless_start || exit 1
+DIR=$BUILD/communicate-two-windows
+
+for windows in 1 2 4 8 16 32 64; do
+    "$DIR/first" "$RESIZES" "$INTERVAL_MS" > /dev/null &
+    controller=$!
+    sleep 0.5
+    measure "windows=$windows" "$DIR/second" "$windows" | grep '^windows='
+    wait "$controller"
+done
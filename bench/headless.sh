@@ -0,0 +1,71 @@
+#!/bin/bash
+# Fixture sourced by the bench scripts. headless_start launches a weston
+# with the headless backend (no GPU or seat needed) on a private
+# WAYLAND_DISPLAY and stops it when the calling script exits; extra weston
+# options can be passed in $WESTON_ARGS. measure runs one demo under it and
+# reports wall time and peak RSS.
+
+BUILD=${BUILD:-$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)/build}
+
+headless_start() {
+    export XDG_RUNTIME_DIR=${XDG_RUNTIME_DIR:-$(mktemp -d)}
+    export WAYLAND_DISPLAY=wayland-headless-$$
+
+    weston --backend=headless-backend.so --socket="$WAYLAND_DISPLAY" \
+        --idle-time=0 $WESTON_ARGS > "$XDG_RUNTIME_DIR/$WAYLAND_DISPLAY.log" 2>&1 &
+    HEADLESS_PID=$!
+    trap headless_stop EXIT
+
+    local socket=$XDG_RUNTIME_DIR/$WAYLAND_DISPLAY
+    for i in $(seq 50); do
+        [ -S "$socket" ] && return 0
+        sleep 0.1
+    done
+    echo "weston headless did not start, see $socket.log" >&2
+    return 1
+}
+
+headless_stop() {
+    if [ -n "$HEADLESS_PID" ]; then
+        kill "$HEADLESS_PID" 2> /dev/null
+        wait "$HEADLESS_PID" 2> /dev/null
+        HEADLESS_PID=
+    fi
+}
+
+# measure <label> <command> [args...]
+# The command's own output passes through; the measurement line follows
+# it as "<label> status=<code> wall=<s> maxrss=<KiB>". Peak RSS needs GNU
+# time and reads "?" without it.
+measure() {
+    local label=$1
+    shift
+    local stats rss=? status start end
+    stats=$(mktemp)
+    start=$(date +%s%N)
+    if [ -x /usr/bin/time ]; then
+        /usr/bin/time -f "%M" -o "$stats" "$@"
+        status=$?
+        rss=$(tail -n 1 "$stats")KiB
+    else
+        "$@"
+        status=$?
+    fi
+    end=$(date +%s%N)
+    rm -f "$stats"
+    printf "%s status=%d wall=%d.%03ds maxrss=%s\n" "$label" "$status" \
+        $(((end - start) / 1000000000)) \
+        $(((end - start) / 1000000 % 1000)) "$rss"
+    return "$status"
+}
+
+# compositor_cpu_ms: user plus system CPU time weston has used so far
+compositor_cpu_ms() {
+    local stat utime stime
+    read -r stat < "/proc/$HEADLESS_PID/stat"
+    # fields 14 and 15, counted after the parenthesised command name
+    set -- ${stat##*) }
+    utime=${12}
+    stime=${13}
+    echo $(((utime + stime) * 1000 / $(getconf CLK_TCK)))
+}
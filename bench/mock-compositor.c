@@ -0,0 +1,365 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-server.h>
+
+#include "xdg-foreign-unstable-v2-server-protocol.h"
+#include "xdg-shell-server-protocol.h"
+#include "mock-compositor.h"
+
+#define MOCK_MAX_COUNTS 64
+
+struct mock_compositor {
+    struct wl_display *display;
+    struct wl_event_loop *loop;
+    struct wl_client *client;
+    struct wl_listener client_destroy;
+    struct wl_protocol_logger *logger;
+
+    // the most recent toplevel, target of mock_compositor_configure()
+    struct wl_resource *xdg_surface;
+    struct wl_resource *toplevel;
+
+    unsigned long requests;
+    uint64_t time_ns;
+    struct mock_request_count counts[MOCK_MAX_COUNTS];
+    int count_len;
+};
+
+// A buffer a surface holds on to, forgotten if the client destroys it
+struct buffer_ref {
+    struct wl_resource *buffer;
+    struct wl_listener destroy;
+};
+
+struct mock_surface {
+    struct mock_compositor *mock;
+    int attached;
+    struct buffer_ref pending;
+    struct buffer_ref current;
+    struct wl_list frame_callbacks;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void buffer_ref_destroyed(struct wl_listener *listener, void *data) {
+    struct buffer_ref *ref = wl_container_of(listener, ref, destroy);
+    ref->buffer = NULL;
+    wl_list_remove(&ref->destroy.link);
+    wl_list_init(&ref->destroy.link);
+}
+
+static void buffer_ref_init(struct buffer_ref *ref) {
+    ref->buffer = NULL;
+    ref->destroy.notify = buffer_ref_destroyed;
+    wl_list_init(&ref->destroy.link);
+}
+
+static void buffer_ref_set(struct buffer_ref *ref, struct wl_resource *buffer) {
+    wl_list_remove(&ref->destroy.link);
+    wl_list_init(&ref->destroy.link);
+    ref->buffer = buffer;
+    if (buffer) {
+        wl_resource_add_destroy_listener(buffer, &ref->destroy);
+    }
+}
+
+static void surface_commit(struct mock_surface *surface) {
+    if (surface->attached) {
+        struct wl_resource *old = surface->current.buffer;
+        if (old && old != surface->pending.buffer) {
+            wl_buffer_send_release(old);
+        }
+        buffer_ref_set(&surface->current, surface->pending.buffer);
+        buffer_ref_set(&surface->pending, NULL);
+        surface->attached = 0;
+    }
+
+    uint32_t time_ms = now_ns() / 1000000;
+    struct wl_resource *callback, *tmp;
+    wl_resource_for_each_safe(callback, tmp, &surface->frame_callbacks) {
+        wl_callback_send_done(callback, time_ms);
+        wl_resource_destroy(callback);
+    }
+}
+
+static int dispatch_request(const void *implementation, void *target,
+                            uint32_t opcode, const struct wl_message *message,
+                            union wl_argument *args);
+
+static void destroy_resource(struct wl_resource *resource) {
+    wl_list_remove(wl_resource_get_link(resource));
+
+    const char *class = wl_resource_get_class(resource);
+    if (!strcmp(class, wl_surface_interface.name)) {
+        struct mock_surface *surface = wl_resource_get_user_data(resource);
+        struct wl_resource *callback, *tmp;
+        wl_resource_for_each_safe(callback, tmp, &surface->frame_callbacks) {
+            wl_resource_destroy(callback);
+        }
+        buffer_ref_set(&surface->pending, NULL);
+        buffer_ref_set(&surface->current, NULL);
+        free(surface);
+        return;
+    }
+
+    struct mock_compositor *mock = wl_resource_get_user_data(resource);
+    if (resource == mock->toplevel) {
+        mock->toplevel = NULL;
+    } else if (resource == mock->xdg_surface) {
+        mock->xdg_surface = NULL;
+        mock->toplevel = NULL;
+    }
+}
+
+// Every object the mock hands out goes through dispatch_request(); user
+// data is the mock_surface for surfaces and the mock for everything else.
+static struct wl_resource *create_resource(struct mock_compositor *mock,
+                                           struct wl_client *client,
+                                           const struct wl_interface *interface,
+                                           int version, uint32_t id) {
+    struct wl_resource *resource =
+        wl_resource_create(client, interface, version, id);
+    if (!resource) {
+        wl_client_post_no_memory(client);
+        return NULL;
+    }
+    void *data = mock;
+    if (interface == &wl_surface_interface) {
+        struct mock_surface *surface = calloc(1, sizeof(*surface));
+        if (!surface) {
+            wl_resource_destroy(resource);
+            wl_client_post_no_memory(client);
+            return NULL;
+        }
+        surface->mock = mock;
+        buffer_ref_init(&surface->pending);
+        buffer_ref_init(&surface->current);
+        wl_list_init(&surface->frame_callbacks);
+        data = surface;
+    }
+    wl_list_init(wl_resource_get_link(resource));
+    wl_resource_set_dispatcher(resource, dispatch_request, mock, data,
+                               destroy_resource);
+    return resource;
+}
+
+// Creates the object for the message's new_id argument, if it has one
+static struct wl_resource *create_new_id(struct mock_compositor *mock,
+                                         struct wl_resource *parent,
+                                         const struct wl_message *message,
+                                         union wl_argument *args) {
+    int i = 0;
+    for (const char *sig = message->signature; *sig; sig++) {
+        if (*sig == '?' || (*sig >= '0' && *sig <= '9')) {
+            continue;
+        }
+        if (*sig == 'n' && message->types[i]) {
+            return create_resource(mock, wl_resource_get_client(parent),
+                                   message->types[i],
+                                   wl_resource_get_version(parent), args[i].n);
+        }
+        i++;
+    }
+    return NULL;
+}
+
+static int dispatch_request(const void *implementation, void *target,
+                            uint32_t opcode, const struct wl_message *message,
+                            union wl_argument *args) {
+    struct mock_compositor *mock = (struct mock_compositor *)implementation;
+    struct wl_resource *resource = target;
+    const char *class = wl_resource_get_class(resource);
+    struct wl_resource *object = create_new_id(mock, resource, message, args);
+
+    if (!strcmp(class, wl_surface_interface.name)) {
+        struct mock_surface *surface = wl_resource_get_user_data(resource);
+        if (!strcmp(message->name, "attach")) {
+            buffer_ref_set(&surface->pending,
+                           (struct wl_resource *)args[0].o);
+            surface->attached = 1;
+        } else if (!strcmp(message->name, "frame") && object) {
+            wl_list_insert(surface->frame_callbacks.prev,
+                           wl_resource_get_link(object));
+        } else if (!strcmp(message->name, "commit")) {
+            surface_commit(surface);
+        }
+    } else if (!strcmp(class, xdg_surface_interface.name)) {
+        if (!strcmp(message->name, "get_toplevel") && object) {
+            mock->xdg_surface = resource;
+            mock->toplevel = object;
+        }
+    } else if (!strcmp(class, zxdg_exporter_v2_interface.name)) {
+        if (!strcmp(message->name, "export_toplevel") && object) {
+            zxdg_exported_v2_send_handle(object, "mock-handle");
+        }
+    }
+
+    if (!strcmp(message->name, "destroy")) {
+        wl_resource_destroy(resource);
+    }
+    return 0;
+}
+
+static const struct {
+    const struct wl_interface *interface;
+    int version;
+} globals[] = {
+    {&wl_compositor_interface, 4},
+    {&xdg_wm_base_interface, 1},
+    {&zxdg_exporter_v2_interface, 1},
+    {&zxdg_importer_v2_interface, 1},
+};
+
+static void bind_global(struct wl_client *client, void *data,
+                        uint32_t version, uint32_t id) {
+    // data is the global's interface; the mock is the client's user data
+    const struct wl_interface *interface = data;
+    create_resource(wl_client_get_user_data(client), client, interface,
+                    version, id);
+}
+
+static void log_message(void *data, enum wl_protocol_logger_type type,
+                        const struct wl_protocol_logger_message *message) {
+    struct mock_compositor *mock = data;
+    if (type != WL_PROTOCOL_LOGGER_REQUEST) {
+        return;
+    }
+    mock->requests++;
+
+    // Names are static strings, so pointer comparison is enough
+    const char *interface = wl_resource_get_class(message->resource);
+    const char *name = message->message->name;
+    for (int i = 0; i < mock->count_len; i++) {
+        struct mock_request_count *count = &mock->counts[i];
+        if (count->interface == interface && count->message == name) {
+            count->count++;
+            return;
+        }
+    }
+    if (mock->count_len < MOCK_MAX_COUNTS) {
+        mock->counts[mock->count_len++] =
+            (struct mock_request_count){interface, name, 1};
+    }
+}
+
+static void handle_client_destroy(struct wl_listener *listener, void *data) {
+    struct mock_compositor *mock =
+        wl_container_of(listener, mock, client_destroy);
+    mock->client = NULL;
+}
+
+struct mock_compositor *mock_compositor_create(int *client_fd) {
+    struct mock_compositor *mock = calloc(1, sizeof(*mock));
+    if (!mock) {
+        perror("calloc");
+        return NULL;
+    }
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+        perror("socketpair");
+        free(mock);
+        return NULL;
+    }
+
+    mock->display = wl_display_create();
+    if (!mock->display || wl_display_init_shm(mock->display) < 0) {
+        fprintf(stderr, "Failed to create the mock display\n");
+        goto err;
+    }
+    mock->loop = wl_display_get_event_loop(mock->display);
+    for (size_t i = 0; i < sizeof(globals) / sizeof(globals[0]); i++) {
+        if (!wl_global_create(mock->display, globals[i].interface,
+                              globals[i].version,
+                              (void *)globals[i].interface, bind_global)) {
+            fprintf(stderr, "Failed to create the %s global\n",
+                    globals[i].interface->name);
+            goto err;
+        }
+    }
+    mock->logger =
+        wl_display_add_protocol_logger(mock->display, log_message, mock);
+
+    mock->client = wl_client_create(mock->display, fds[0]);
+    if (!mock->client) {
+        fprintf(stderr, "Failed to create the mock client\n");
+        goto err;
+    }
+    wl_client_set_user_data(mock->client, mock, NULL);
+    mock->client_destroy.notify = handle_client_destroy;
+    wl_client_add_destroy_listener(mock->client, &mock->client_destroy);
+
+    *client_fd = fds[1];
+    return mock;
+
+err:
+    if (mock->display) {
+        wl_display_destroy(mock->display);
+    }
+    close(fds[0]);
+    close(fds[1]);
+    free(mock);
+    return NULL;
+}
+
+void mock_compositor_destroy(struct mock_compositor *mock) {
+    if (mock->client) {
+        wl_client_destroy(mock->client);
+    }
+    wl_protocol_logger_destroy(mock->logger);
+    wl_display_destroy(mock->display);
+    free(mock);
+}
+
+void mock_compositor_dispatch(struct mock_compositor *mock) {
+    uint64_t start = now_ns();
+    wl_event_loop_dispatch(mock->loop, 0);
+    wl_display_flush_clients(mock->display);
+    mock->time_ns += now_ns() - start;
+}
+
+int mock_compositor_configure(struct mock_compositor *mock, int width,
+                              int height) {
+    if (!mock->toplevel) {
+        return -1;
+    }
+    uint64_t start = now_ns();
+    struct wl_array states;
+    wl_array_init(&states);
+    xdg_toplevel_send_configure(mock->toplevel, width, height, &states);
+    wl_array_release(&states);
+    xdg_surface_send_configure(mock->xdg_surface,
+                               wl_display_next_serial(mock->display));
+    wl_display_flush_clients(mock->display);
+    mock->time_ns += now_ns() - start;
+    return 0;
+}
+
+unsigned long mock_compositor_requests(const struct mock_compositor *mock) {
+    return mock->requests;
+}
+
+uint64_t mock_compositor_time_ns(const struct mock_compositor *mock) {
+    return mock->time_ns;
+}
+
+int mock_compositor_request_counts(const struct mock_compositor *mock,
+                                   const struct mock_request_count **counts) {
+    *counts = mock->counts;
+    return mock->count_len;
+}
+
+void mock_compositor_reset_counts(struct mock_compositor *mock) {
+    mock->requests = 0;
+    mock->time_ns = 0;
+    mock->count_len = 0;
+}
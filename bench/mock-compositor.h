@@ -0,0 +1,48 @@
+#ifndef MOCK_COMPOSITOR_H
+#define MOCK_COMPOSITOR_H
+
+#include <stdint.h>
+
+/*
+ * An in-process stand-in for a compositor, built on libwayland-server, for
+ * micro-benchmarks of client code. It advertises wl_compositor, wl_shm,
+ * xdg_wm_base and zxdg_exporter_v2/zxdg_importer_v2, accepts any request
+ * on them, and does only what a client waits for: frame callbacks fire
+ * and the previous buffer is released on every commit, exported toplevels
+ * get a handle.
+ *
+ * Nothing runs on its own. The benchmark drives both ends from one thread
+ * (mock_compositor_dispatch() after the client flushes), which keeps runs
+ * deterministic, and injects configures whenever it likes. Every request
+ * is counted per interface and message, and the time spent inside
+ * mock_compositor_dispatch() is summed so it can be subtracted from the
+ * client's.
+ */
+struct mock_compositor;
+
+struct mock_request_count {
+    const char *interface;
+    const char *message;
+    unsigned long count;
+};
+
+// Returns the fd to hand to wl_display_connect_to_fd()
+struct mock_compositor *mock_compositor_create(int *client_fd);
+void mock_compositor_destroy(struct mock_compositor *mock);
+
+// Process whatever the client has sent and flush the replies
+void mock_compositor_dispatch(struct mock_compositor *mock);
+
+// Sends xdg_toplevel.configure and xdg_surface.configure to the most
+// recently created toplevel; returns -1 if there is none yet.
+int mock_compositor_configure(struct mock_compositor *mock, int width,
+                              int height);
+
+unsigned long mock_compositor_requests(const struct mock_compositor *mock);
+uint64_t mock_compositor_time_ns(const struct mock_compositor *mock);
+// Per message counts, in first-seen order; returns how many there are
+int mock_compositor_request_counts(const struct mock_compositor *mock,
+                                   const struct mock_request_count **counts);
+void mock_compositor_reset_counts(struct mock_compositor *mock);
+
+#endif
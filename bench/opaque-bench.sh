@@ -0,0 +1,35 @@
+#!/bin/bash
+# Compositor cost of blending: runs the exporter and attach-two-surfaces
+# against a headless weston with DEMOS_OPAQUE=0 (ARGB8888, no opaque
+# region) and DEMOS_OPAQUE=1 (XRGB8888 plus opaque regions), and reports
+# the CPU time weston spent on each run. weston has to actually composite,
+# so the pixman renderer is used unless $WESTON_ARGS says otherwise. Uses
+# the binaries in $BUILD (default: build/).
+
+STEPS=${STEPS:-2000}
+INTERVAL_MS=${INTERVAL_MS:-4}
+WESTON_ARGS=${WESTON_ARGS:---renderer=pixman}
+# compare like with like: opaque content would otherwise go to RGB565
+export DEMOS_RGB565=0
+
+. "$(dirname "$0")/headless.sh"
+headless_start || exit 1
+
+# run <label> <command> [args...]
+run() {
+    local label=$1 before after
+    shift
+    for opaque in 0 1; do
+        before=$(compositor_cpu_ms)
+        DEMOS_OPAQUE=$opaque measure "$label opaque=$opaque" "$@" > /dev/null
+        after=$(compositor_cpu_ms)
+        echo "$label opaque=$opaque compositor_cpu=$((after - before))ms"
+    done
+}
+
+run exporter timeout 60 \
+    "$BUILD/xdg-foreign/exporter" "$STEPS" "$INTERVAL_MS"
+# shm buffers, a single-pixel buffer would be opaque either way
+DEMOS_SINGLE_PIXEL=0 run attach-two-surfaces timeout 60 \
+    "$BUILD/attach-two-surfaces/attach-two-surfaces" toplevel "$STEPS" \
+    "$INTERVAL_MS"
@@ -0,0 +1,51 @@
+#!/bin/bash
+# Profile-guided build of the demos:
+#   1. a plain -O2/LTO build, timed on the training workload
+#   2. an instrumented build (DEMOS_PGO=GENERATE) run on the same workload
+#   3. an optimised rebuild from those profiles (DEMOS_PGO=USE), timed again
+# The workload is a scripted exporter run (colour swaps and resizes through
+# draw_chess_board() and the configure handler) and a follower resize storm
+# (first/second). Everything runs under a headless weston.
+
+set -e
+
+SRC=$(cd "$(dirname "$0")/.." && pwd)
+OUT=${OUT:-$SRC/build-pgo}
+STEPS=${STEPS:-2000}
+RESIZES=${RESIZES:-2000}
+PROFILE_DIR=$OUT/profile
+
+. "$SRC/bench/headless.sh"
+headless_start
+
+build() {
+    cmake -S "$SRC" -B "$OUT/$1" -DDEMOS_PGO="$2" \
+        -DDEMOS_PGO_DIR="$PROFILE_DIR" > /dev/null
+    cmake --build "$OUT/$1" -j"$(nproc)" > /dev/null
+}
+
+workload() {
+    "$OUT/$1/xdg-foreign/exporter" "$STEPS" | grep '^draw '
+    "$OUT/$1/communicate-two-windows/first" "$RESIZES" 2 > /dev/null &
+    local controller=$!
+    sleep 0.5
+    "$OUT/$1/communicate-two-windows/second" 4 | grep '^windows='
+    wait "$controller"
+}
+
+build baseline OFF
+echo "before:"
+workload baseline
+
+rm -rf "$PROFILE_DIR"
+build generate GENERATE
+workload generate > /dev/null
+if [ -n "$(find "$PROFILE_DIR" -name '*.profraw' -print -quit)" ]; then
+    # clang writes raw profiles that have to be merged first
+    llvm-profdata merge -o "$PROFILE_DIR/default.profdata" \
+        "$PROFILE_DIR"/*.profraw
+fi
+
+build optimised USE
+echo "after:"
+workload optimised
@@ -0,0 +1,140 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log.h"
+#include "pattern-fill.h"
+#include "renderer.h"
+#include "tile-render.h"
+
+// Frame times of every renderer backend for the exporter's chess board and
+// the solid fills of the other demos, plus the board drawn into an RGB565
+// buffer. Each frame is begin_frame ..
+// end_frame, so the egl figures include reading the pixels back.
+
+struct size {
+    const char *name;
+    int width, height;
+};
+
+static const struct size sizes[] = {
+    {"500x500", 500, 500},
+    {"1080p", 1920, 1080},
+    {"4K", 3840, 2160},
+};
+
+static uint32_t first_color = 0xFF666666;
+static uint32_t second_color = 0xFFEEEEEE;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Run fill for roughly half a second and return the mean time per frame.
+#define TIME_FRAMES(ms_out, stmt)                                   \
+    do {                                                            \
+        int frames = 0;                                             \
+        double start = now_ms(), elapsed;                           \
+        do {                                                        \
+            stmt;                                                   \
+            frames++;                                               \
+            elapsed = now_ms() - start;                             \
+        } while (elapsed < 500.0);                                  \
+        ms_out = elapsed / frames;                                  \
+    } while (0)
+
+static void frame_checker(struct renderer *renderer, uint32_t *pixels,
+                          int width, int height) {
+    renderer_begin_frame(renderer, pixels, width, height, width);
+    renderer_checker(renderer, 0, 0, width, height, first_color,
+                     second_color);
+    renderer_end_frame(renderer);
+}
+
+static void frame_checker16(struct renderer *renderer, uint16_t *pixels,
+                            int width, int height) {
+    renderer_begin_frame_rgb565(renderer, pixels, width, height, width);
+    renderer_checker(renderer, 0, 0, width, height, first_color,
+                     second_color);
+    renderer_end_frame(renderer);
+}
+
+static void frame_solid(struct renderer *renderer, uint32_t *pixels,
+                        int width, int height) {
+    renderer_begin_frame(renderer, pixels, width, height, width);
+    renderer_fill_rect(renderer, 0, 0, width, height, first_color);
+    renderer_end_frame(renderer);
+}
+
+// Usage: renderer-bench [renderer...]
+int main(int argc, char **argv) {
+    const char *const *names = renderer_names();
+    if (argc > 1) {
+        names = (const char *const *)argv + 1;
+    }
+    log_init();
+    tile_render_init(0);
+
+    printf("%-8s %-9s %12s %12s %12s\n", "size", "renderer",
+           "checker ms", "solid ms", "rgb565 ms");
+    for (const char *const *name = names; *name; name++) {
+        struct renderer *renderer = renderer_create(*name);
+        if (!renderer) {
+            printf("%-8s %-9s %12s\n", "-", *name, "n/a");
+            continue;
+        }
+
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            int width = sizes[s].width;
+            int height = sizes[s].height;
+            size_t bytes = (size_t)width * height * 4;
+            uint32_t *expected = malloc(bytes);
+            uint32_t *pixels = malloc(bytes);
+            uint16_t *expected16 = malloc(bytes / 2);
+            uint16_t *pixels16 = malloc(bytes / 2);
+            if (!expected || !pixels || !expected16 || !pixels16) {
+                perror("malloc");
+                return 1;
+            }
+            pattern_fill_checker(expected, width, 0, 0, width, height,
+                                 first_color, second_color);
+            pattern_fill_checker16(expected16, width, 0, 0, width, height,
+                                   first_color, second_color);
+
+            memset(pixels, 0, bytes);
+            double checker, solid, checker16;
+            TIME_FRAMES(checker, frame_checker(renderer, pixels, width,
+                                               height));
+            if (memcmp(pixels, expected, bytes) != 0) {
+                fprintf(stderr, "%s output differs from the reference\n",
+                        *name);
+                return 1;
+            }
+            TIME_FRAMES(solid, frame_solid(renderer, pixels, width, height));
+            memset(pixels16, 0, bytes / 2);
+            TIME_FRAMES(checker16, frame_checker16(renderer, pixels16, width,
+                                                   height));
+            if (memcmp(pixels16, expected16, bytes / 2) != 0) {
+                fprintf(stderr, "%s rgb565 output differs from the reference\n",
+                        *name);
+                return 1;
+            }
+            printf("%-8s %-9s %12.3f %12.3f %12.3f\n", sizes[s].name,
+                   *name, checker, solid, checker16);
+
+            free(expected);
+            free(pixels);
+            free(expected16);
+            free(pixels16);
+        }
+        renderer_destroy(renderer);
+    }
+    tile_render_finish();
+    log_finish();
+    return 0;
+}
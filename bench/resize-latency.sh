@@ -0,0 +1,21 @@
+#!/bin/bash
+# Resize propagation latency: starts a headless weston, has the controller
+# broadcast RESIZES scripted sizes and reports the time from each publish
+# (CLOCK_MONOTONIC, taken by the controller as it publishes) to the
+# follower committing a buffer of that size. Scripted sizes skip
+# xdg_toplevel.configure, so the compositor's configure round trip is not
+# included. Uses the binaries in $BUILD (default: build/).
+
+RESIZES=${RESIZES:-5000}
+INTERVAL_MS=${INTERVAL_MS:-2}
+WINDOWS=${WINDOWS:-1}
+
+. "$(dirname "$0")/headless.sh"
+headless_start || exit 1
+DIR=$BUILD/communicate-two-windows
+
+"$DIR/first" "$RESIZES" "$INTERVAL_MS" > /dev/null &
+controller=$!
+sleep 0.5
+"$DIR/second" "$WINDOWS"
+wait "$controller"
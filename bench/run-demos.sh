@@ -0,0 +1,67 @@
+#!/bin/bash
+# Runs every demo against a private headless weston with scripted resize
+# and redraw sequences, printing timing and memory for each. Exits non-zero
+# if any demo fails, so it can gate a GPU-less CI box.
+#
+#   BUILD         build directory (default: build/)
+#   STEPS         exporter redraw and attach-two-surfaces steps (default 500)
+#   RESIZES       controller resizes broadcast to the followers (default 500)
+#   WINDOWS       follower windows (default 4)
+#   IDLE_SECONDS  how long demos without a scripted mode stay up (default 2)
+
+. "$(dirname "$0")/headless.sh"
+
+STEPS=${STEPS:-500}
+RESIZES=${RESIZES:-500}
+WINDOWS=${WINDOWS:-4}
+IDLE_SECONDS=${IDLE_SECONDS:-2}
+failed=0
+
+check() {
+    # timeout reports 124 for demos that only stop when told to
+    if [ "$1" -ne 0 ] && [ "$1" -ne 124 ]; then
+        echo "FAILED: $2" >&2
+        failed=1
+    fi
+}
+
+headless_start || exit 1
+
+for mode in toplevel subsurface; do
+    measure "attach-two-surfaces-$mode" timeout 60 \
+        "$BUILD/attach-two-surfaces/attach-two-surfaces" "$mode" "$STEPS"
+    check $? "attach-two-surfaces $mode"
+done
+
+# The importer needs the handle the exporter prints once it is mapped
+exporter_log=$(mktemp)
+measure exporter "$BUILD/xdg-foreign/exporter" "$STEPS" > "$exporter_log" &
+exporter=$!
+for i in $(seq 50); do
+    handle=$(sed -n 's/^Handle: //p' "$exporter_log")
+    [ -n "$handle" ] && break
+    sleep 0.1
+done
+if [ -n "$handle" ]; then
+    measure importer timeout -s INT "$IDLE_SECONDS" \
+        "$BUILD/xdg-foreign/importer" "$handle" > /dev/null
+    check $? importer
+else
+    echo "FAILED: exporter never printed a handle" >&2
+    failed=1
+fi
+wait "$exporter"
+check $? exporter
+grep -E '^(draw|exporter) ' "$exporter_log"
+rm -f "$exporter_log"
+
+measure first "$BUILD/communicate-two-windows/first" "$RESIZES" 2 \
+    > /dev/null &
+controller=$!
+sleep 0.5
+measure second "$BUILD/communicate-two-windows/second" "$WINDOWS"
+check $? second
+wait "$controller"
+check $? first
+
+exit $failed
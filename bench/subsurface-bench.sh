@@ -0,0 +1,18 @@
+#!/bin/bash
+# Child window compositing: runs attach-two-surfaces with the child as a
+# second toplevel and as a subsurface against a headless weston. Each run
+# reports the time from a step starting to the frame callbacks of every
+# surface it committed, separately for parent resizes and for child-only
+# updates. Uses the binaries in $BUILD (default: build/).
+
+STEPS=${STEPS:-1000}
+INTERVAL_MS=${INTERVAL_MS:-4}
+
+. "$(dirname "$0")/headless.sh"
+headless_start || exit 1
+DIR=$BUILD/attach-two-surfaces
+
+for mode in toplevel subsurface; do
+    measure "$mode" timeout 60 \
+        "$DIR/attach-two-surfaces" "$mode" "$STEPS" "$INTERVAL_MS"
+done
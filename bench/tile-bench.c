@@ -0,0 +1,112 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pattern-fill.h"
+#include "tile-render.h"
+
+// Scaling of tile_fill_checker() and tile_fill_solid() from one thread up
+// to every online CPU (or the count given on the command line).
+
+struct size {
+    const char *name;
+    int width, height;
+};
+
+static const struct size sizes[] = {
+    {"1080p", 1920, 1080},
+    {"4K", 3840, 2160},
+    {"8K", 7680, 4320},
+};
+
+static uint32_t first_color = 0xFF666666;
+static uint32_t second_color = 0xFFEEEEEE;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Run fill for roughly half a second and return the mean time per frame.
+#define TIME_FRAMES(ms_out, stmt)                                   \
+    do {                                                            \
+        int frames = 0;                                             \
+        double start = now_ms(), elapsed;                           \
+        do {                                                        \
+            stmt;                                                   \
+            frames++;                                               \
+            elapsed = now_ms() - start;                             \
+        } while (elapsed < 500.0);                                  \
+        ms_out = elapsed / frames;                                  \
+    } while (0)
+
+// Usage: tile-bench [max_threads]
+int main(int argc, char **argv) {
+    int max_threads = argc > 1 ? atoi(argv[1])
+                               : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (max_threads < 1 || max_threads > TILE_RENDER_MAX_THREADS) {
+        max_threads = TILE_RENDER_MAX_THREADS;
+    }
+
+    printf("kernel %s, %dx%d tiles\n", pattern_fill_isa_name(), TILE_SIZE,
+           TILE_SIZE);
+    printf("%-6s %7s %12s %12s %9s %9s\n", "size", "threads",
+           "checker ms", "solid ms", "GB/s", "speedup");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int width = sizes[s].width;
+        int height = sizes[s].height;
+        size_t bytes = (size_t)width * height * 4;
+        uint32_t *expected = malloc(bytes);
+        uint32_t *pixels = malloc(bytes);
+        if (!expected || !pixels) {
+            perror("malloc");
+            return 1;
+        }
+        pattern_fill_checker(expected, width, 0, 0, width, height,
+                             first_color, second_color);
+
+        double single = 0;
+        // 1, 2, 4, ... and finally max_threads itself
+        for (int threads = 1;;
+             threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+            if (tile_render_init(threads) < 0) {
+                fprintf(stderr, "could only start %d threads\n",
+                        tile_render_thread_count());
+            }
+
+            memset(pixels, 0, bytes);
+            double checker, solid;
+            TIME_FRAMES(checker,
+                        tile_fill_checker(pixels, width, 0, 0, width, height,
+                                          first_color, second_color));
+            if (memcmp(pixels, expected, bytes) != 0) {
+                fprintf(stderr, "%d thread output differs from the "
+                        "reference\n", threads);
+                return 1;
+            }
+            TIME_FRAMES(solid, tile_fill_solid(pixels, width, 0, 0, width,
+                                               height, first_color));
+            tile_render_finish();
+
+            if (threads == 1) {
+                single = checker;
+            }
+            printf("%-6s %7d %12.3f %12.3f %9.2f %8.2fx\n", sizes[s].name,
+                   threads, checker, solid, bytes / checker / 1e6,
+                   single / checker);
+            if (threads == max_threads) {
+                break;
+            }
+        }
+
+        free(expected);
+        free(pixels);
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <limits.h>
+
+#include "damage.h"
+
+static long rect_area(const struct damage_rect *r) {
+    return (long)r->width * r->height;
+}
+
+static struct damage_rect rect_union(const struct damage_rect *a,
+                                     const struct damage_rect *b) {
+    int x0 = a->x < b->x ? a->x : b->x;
+    int y0 = a->y < b->y ? a->y : b->y;
+    int x1 = a->x + a->width > b->x + b->width ? a->x + a->width
+                                               : b->x + b->width;
+    int y1 = a->y + a->height > b->y + b->height ? a->y + a->height
+                                                 : b->y + b->height;
+    struct damage_rect r = {x0, y0, x1 - x0, y1 - y0};
+    return r;
+}
+
+static struct damage_rect rect_intersect(const struct damage_rect *a,
+                                         const struct damage_rect *b) {
+    int x0 = a->x > b->x ? a->x : b->x;
+    int y0 = a->y > b->y ? a->y : b->y;
+    int x1 = a->x + a->width < b->x + b->width ? a->x + a->width
+                                               : b->x + b->width;
+    int y1 = a->y + a->height < b->y + b->height ? a->y + a->height
+                                                 : b->y + b->height;
+    struct damage_rect r = {x0, y0, x1 - x0, y1 - y0};
+    if (r.width < 0 || r.height < 0) {
+        r.width = 0;
+        r.height = 0;
+    }
+    return r;
+}
+
+// Pixels that merging a and b would repaint without either asking for it.
+static long merge_waste(const struct damage_rect *a,
+                        const struct damage_rect *b) {
+    struct damage_rect u = rect_union(a, b);
+    struct damage_rect i = rect_intersect(a, b);
+    return rect_area(&u) - rect_area(a) - rect_area(b) + rect_area(&i);
+}
+
+void damage_clear(struct damage *damage) {
+    damage->count = 0;
+}
+
+int damage_empty(const struct damage *damage) {
+    return damage->count == 0;
+}
+
+void damage_add(struct damage *damage, int x, int y, int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    struct damage_rect r = {x, y, width, height};
+
+    for (;;) {
+        int best = -1;
+        long best_waste = LONG_MAX;
+        for (int i = 0; i < damage->count; i++) {
+            long waste = merge_waste(&damage->rects[i], &r);
+            if (waste < best_waste) {
+                best = i;
+                best_waste = waste;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+
+        // Merge overlapping, touching or nearly touching rects; when the
+        // list is full there is no choice.
+        long limit = (rect_area(&damage->rects[best]) + rect_area(&r)) / 4;
+        if (best_waste > limit && damage->count < DAMAGE_MAX_RECTS) {
+            break;
+        }
+        r = rect_union(&damage->rects[best], &r);
+        damage->rects[best] = damage->rects[--damage->count];
+    }
+
+    damage->rects[damage->count++] = r;
+}
+
+void damage_submit(const struct damage *damage, struct wl_surface *surface) {
+    for (int i = 0; i < damage->count; i++) {
+        const struct damage_rect *r = &damage->rects[i];
+        wl_surface_damage_buffer(surface, r->x, r->y, r->width, r->height);
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef DAMAGE_H
+#define DAMAGE_H
+
+#include <wayland-client.h>
+
+#define DAMAGE_MAX_RECTS 8
+
+struct damage_rect {
+    int x, y, width, height;
+};
+
+/*
+ * A short list of buffer-space rectangles. damage_add() merges a new rect
+ * into an existing one when that wastes little area, and once the list is
+ * full always merges into the cheapest candidate, so the list stays small
+ * enough to hand straight to wl_surface_damage_buffer.
+ *
+ * The exporter damages the whole board on a colour swap, and on a resize
+ * only the strips between the old and the new size, which several
+ * configures in one frame add up to.
+ */
+struct damage {
+    struct damage_rect rects[DAMAGE_MAX_RECTS];
+    int count;
+};
+
+void damage_clear(struct damage *damage);
+int damage_empty(const struct damage *damage);
+void damage_add(struct damage *damage, int x, int y, int width, int height);
+void damage_submit(const struct damage *damage, struct wl_surface *surface);
+
+#endif
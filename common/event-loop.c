@@ -0,0 +1,305 @@
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "event-loop.h"
+
+enum event_source_type {
+    EVENT_SOURCE_FD,
+    EVENT_SOURCE_TIMER,
+    EVENT_SOURCE_SIGNAL,
+};
+
+struct event_source {
+    struct event_loop *loop;
+    enum event_source_type type;
+    int fd;
+    int signo;
+    int removed;
+    event_source_func func;
+    void *data;
+    struct event_source *next;
+};
+
+#define MAX_EVENTS 32
+
+int event_loop_init(struct event_loop *loop, struct wl_display *display,
+                    struct wl_event_queue *queue) {
+    loop->display = display;
+    loop->queue = queue;
+    loop->display_events = EPOLLIN;
+    loop->destroy_list = NULL;
+    loop->running = 0;
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+
+    // The display is the only entry without a source behind it.
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, wl_display_get_fd(display),
+                  &ev) < 0) {
+        perror("epoll_ctl");
+        close(loop->epoll_fd);
+        return -1;
+    }
+    return 0;
+}
+
+static struct event_source *add_source(struct event_loop *loop,
+                                       enum event_source_type type, int fd,
+                                       uint32_t events,
+                                       event_source_func func, void *data) {
+    struct event_source *source = calloc(1, sizeof(*source));
+    if (!source) {
+        perror("calloc");
+        return NULL;
+    }
+    source->loop = loop;
+    source->type = type;
+    source->fd = fd;
+    source->func = func;
+    source->data = data;
+
+    struct epoll_event ev = {.events = events, .data.ptr = source};
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("epoll_ctl");
+        free(source);
+        return NULL;
+    }
+    return source;
+}
+
+struct event_source *event_loop_add_fd(struct event_loop *loop, int fd,
+                                       uint32_t events,
+                                       event_source_func func, void *data) {
+    return add_source(loop, EVENT_SOURCE_FD, fd, events, func, data);
+}
+
+struct event_source *event_loop_add_timer(struct event_loop *loop,
+                                          event_source_func func, void *data) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        perror("timerfd_create");
+        return NULL;
+    }
+    struct event_source *source =
+        add_source(loop, EVENT_SOURCE_TIMER, fd, EPOLLIN, func, data);
+    if (!source) {
+        close(fd);
+    }
+    return source;
+}
+
+// A delay of 0 disarms the timer; an interval of 0 makes it one-shot.
+int event_source_timer_update(struct event_source *source, int delay_ms,
+                              int interval_ms) {
+    struct itimerspec its = {
+        .it_value = {delay_ms / 1000, (delay_ms % 1000) * 1000000L},
+        .it_interval = {interval_ms / 1000, (interval_ms % 1000) * 1000000L},
+    };
+    if (timerfd_settime(source->fd, 0, &its, NULL) < 0) {
+        perror("timerfd_settime");
+        return -1;
+    }
+    return 0;
+}
+
+struct event_source *event_loop_add_signal(struct event_loop *loop, int signo,
+                                           event_source_func func, void *data) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, signo);
+    int fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd < 0) {
+        perror("signalfd");
+        return NULL;
+    }
+    struct event_source *source =
+        add_source(loop, EVENT_SOURCE_SIGNAL, fd, EPOLLIN, func, data);
+    if (!source) {
+        close(fd);
+        return NULL;
+    }
+    // only now stop the default action, so a failure leaves it in place
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    source->signo = signo;
+    return source;
+}
+
+// Safe to call from any callback, including for a source that already has
+// an event waiting in the current batch.
+void event_source_remove(struct event_source *source) {
+    if (source->removed) {
+        return;
+    }
+    struct event_loop *loop = source->loop;
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
+    if (source->type != EVENT_SOURCE_FD) {
+        close(source->fd);
+    }
+    if (source->type == EVENT_SOURCE_SIGNAL) {
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, source->signo);
+        sigprocmask(SIG_UNBLOCK, &mask, NULL);
+    }
+    source->removed = 1;
+    source->next = loop->destroy_list;
+    loop->destroy_list = source;
+}
+
+static void dispatch_source(struct event_source *source, uint32_t events) {
+    switch (source->type) {
+    case EVENT_SOURCE_FD:
+        source->func(source->data, events);
+        break;
+    case EVENT_SOURCE_TIMER: {
+        uint64_t expirations;
+        if (read(source->fd, &expirations, sizeof(expirations)) ==
+            sizeof(expirations)) {
+            source->func(source->data, expirations);
+        }
+        break;
+    }
+    case EVENT_SOURCE_SIGNAL: {
+        struct signalfd_siginfo info;
+        while (read(source->fd, &info, sizeof(info)) == sizeof(info)) {
+            source->func(source->data, info.ssi_signo);
+        }
+        break;
+    }
+    }
+}
+
+static void destroy_removed(struct event_loop *loop) {
+    while (loop->destroy_list) {
+        struct event_source *source = loop->destroy_list;
+        loop->destroy_list = source->next;
+        free(source);
+    }
+}
+
+static int prepare_read(struct event_loop *loop) {
+    if (loop->queue) {
+        return wl_display_prepare_read_queue(loop->display, loop->queue);
+    }
+    return wl_display_prepare_read(loop->display);
+}
+
+static int dispatch_pending(struct event_loop *loop) {
+    if (loop->queue) {
+        return wl_display_dispatch_queue_pending(loop->display, loop->queue);
+    }
+    return wl_display_dispatch_pending(loop->display);
+}
+
+// Only watch for the display becoming writable while a flush is pending,
+// or every wait would return at once.
+static int set_display_events(struct event_loop *loop, uint32_t events) {
+    if (events == loop->display_events) {
+        return 0;
+    }
+    struct epoll_event ev = {.events = events, .data.ptr = NULL};
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD,
+                  wl_display_get_fd(loop->display), &ev) < 0) {
+        perror("epoll_ctl");
+        return -1;
+    }
+    loop->display_events = events;
+    return 0;
+}
+
+// Flushes what it can. Returns -1 once the connection is broken.
+static int flush_display(struct event_loop *loop) {
+    if (wl_display_flush(loop->display) < 0) {
+        if (errno != EAGAIN) {
+            return -1;
+        }
+        return set_display_events(loop, EPOLLIN | EPOLLOUT);
+    }
+    return set_display_events(loop, EPOLLIN);
+}
+
+// Waits up to timeout_ms (-1 forever) and dispatches whatever is ready.
+// Returns -1 once the Wayland connection is broken.
+int event_loop_dispatch(struct event_loop *loop, int timeout_ms) {
+    while (prepare_read(loop) != 0) {
+        if (dispatch_pending(loop) < 0) {
+            return -1;
+        }
+    }
+    if (flush_display(loop) < 0) {
+        wl_display_cancel_read(loop->display);
+        return -1;
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(loop->epoll_fd, events, MAX_EVENTS, timeout_ms);
+    if (count < 0) {
+        wl_display_cancel_read(loop->display);
+        if (errno == EINTR) {
+            return 0;
+        }
+        perror("epoll_wait");
+        return -1;
+    }
+
+    int display_ready = 0;
+    int display_writable = 0;
+    for (int i = 0; i < count; i++) {
+        if (!events[i].data.ptr) {
+            display_ready = events[i].events & ~EPOLLOUT;
+            display_writable = events[i].events & EPOLLOUT;
+        }
+    }
+    if (display_writable && flush_display(loop) < 0) {
+        wl_display_cancel_read(loop->display);
+        return -1;
+    }
+    if (display_ready) {
+        if (wl_display_read_events(loop->display) < 0) {
+            return -1;
+        }
+    } else {
+        wl_display_cancel_read(loop->display);
+    }
+    if (dispatch_pending(loop) < 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        struct event_source *source = events[i].data.ptr;
+        if (source && !source->removed) {
+            dispatch_source(source, events[i].events);
+        }
+    }
+    destroy_removed(loop);
+    return 0;
+}
+
+int event_loop_run(struct event_loop *loop) {
+    loop->running = 1;
+    while (loop->running) {
+        if (event_loop_dispatch(loop, -1) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void event_loop_quit(struct event_loop *loop) {
+    loop->running = 0;
+}
+
+void event_loop_finish(struct event_loop *loop) {
+    destroy_removed(loop);
+    close(loop->epoll_fd);
+    loop->epoll_fd = -1;
+}
@@ -0,0 +1,50 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdint.h>
+#include <wayland-client.h>
+
+/*
+ * Callback for an event source. value is the epoll event mask for fd
+ * sources, the number of expirations for timers and the signal number for
+ * signal sources.
+ */
+typedef void (*event_source_func)(void *data, uint32_t value);
+
+struct event_source;
+
+/*
+ * epoll based loop that waits on the Wayland connection together with any
+ * number of fds, timers and signals. Wayland events are read with
+ * wl_display_prepare_read()/read_events(), so nothing queued by another
+ * thread (or by libvlc on its own queue) is ever slept through. Requests
+ * that do not fit in the socket buffer are flushed once it drains.
+ */
+struct event_loop {
+    int epoll_fd;
+    struct wl_display *display;
+    struct wl_event_queue *queue;
+    uint32_t display_events;
+    struct event_source *destroy_list;
+    int running;
+};
+
+int event_loop_init(struct event_loop *loop, struct wl_display *display,
+                    struct wl_event_queue *queue);
+struct event_source *event_loop_add_fd(struct event_loop *loop, int fd,
+                                       uint32_t events,
+                                       event_source_func func, void *data);
+struct event_source *event_loop_add_timer(struct event_loop *loop,
+                                          event_source_func func, void *data);
+int event_source_timer_update(struct event_source *source, int delay_ms,
+                              int interval_ms);
+struct event_source *event_loop_add_signal(struct event_loop *loop, int signo,
+                                           event_source_func func, void *data);
+void event_source_remove(struct event_source *source);
+
+int event_loop_dispatch(struct event_loop *loop, int timeout_ms);
+int event_loop_run(struct event_loop *loop);
+void event_loop_quit(struct event_loop *loop);
+void event_loop_finish(struct event_loop *loop);
+
+#endif
@@ -0,0 +1,110 @@
+#include <time.h>
+
+#include "frame-scheduler.h"
+#include "trace.h"
+
+// Until two frame callbacks have arrived, assume a 60 Hz output.
+#define DEFAULT_INTERVAL_MS (1000.0 / 60.0)
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void render_now(struct frame_scheduler *sched);
+
+static void frame_done(void *data, struct wl_callback *callback,
+                       uint32_t time) {
+    struct frame_scheduler *sched = data;
+    TRACE_INSTANT("frame_done");
+    wl_callback_destroy(callback);
+    sched->callback = NULL;
+
+    if (sched->last_time) {
+        uint32_t delta = time - sched->last_time;
+        // ignore gaps where nothing was rendered, they say nothing about
+        // the refresh rate
+        if (delta > 0 && delta < 4 * DEFAULT_INTERVAL_MS) {
+            sched->interval_ms = 0.9 * sched->interval_ms + 0.1 * delta;
+        }
+    }
+    sched->last_time = time;
+
+    if (sched->dirty) {
+        render_now(sched);
+    }
+}
+
+static const struct wl_callback_listener frame_listener = {
+    .done = frame_done,
+};
+
+static void render_now(struct frame_scheduler *sched) {
+    // The frame request has to be part of the commit render is about to do.
+    sched->callback = wl_surface_frame(sched->surface);
+    wl_callback_add_listener(sched->callback, &frame_listener, sched);
+
+    sched->dirty = 0;
+    sched->frame_start_ms = now_ms();
+    sched->frames++;
+    TRACE_BEGIN("render");
+    if (sched->render(sched->data) < 0) {
+        sched->dirty = 1;
+    }
+    TRACE_END("render");
+
+    double budget = frame_scheduler_budget_ms(sched);
+    if (sched->frames == 1 || budget < sched->min_budget_ms) {
+        sched->min_budget_ms = budget;
+    }
+}
+
+void frame_scheduler_init(struct frame_scheduler *sched,
+                          struct wl_surface *surface,
+                          frame_render_func render, void *data) {
+    sched->surface = surface;
+    sched->callback = NULL;
+    sched->render = render;
+    sched->data = data;
+    sched->dirty = 0;
+    sched->last_time = 0;
+    sched->interval_ms = DEFAULT_INTERVAL_MS;
+    sched->frame_start_ms = 0;
+    sched->frames = 0;
+    sched->coalesced = 0;
+    sched->min_budget_ms = 0;
+}
+
+void frame_scheduler_schedule(struct frame_scheduler *sched) {
+    if (sched->callback) {
+        if (sched->dirty) {
+            TRACE_INSTANT("frame_coalesced");
+            sched->coalesced++;
+        }
+        sched->dirty = 1;
+        return;
+    }
+    render_now(sched);
+}
+
+// Time left in the current frame before the compositor wants the next one.
+double frame_scheduler_budget_ms(const struct frame_scheduler *sched) {
+    return sched->interval_ms - (now_ms() - sched->frame_start_ms);
+}
+
+void frame_scheduler_print_stats(const struct frame_scheduler *sched,
+                                 FILE *out, const char *label) {
+    fprintf(out, "%s frames=%lu coalesced=%lu interval=%.1fms "
+            "min_budget=%.1fms\n",
+            label, sched->frames, sched->coalesced, sched->interval_ms,
+            sched->min_budget_ms);
+}
+
+void frame_scheduler_finish(struct frame_scheduler *sched) {
+    if (sched->callback) {
+        wl_callback_destroy(sched->callback);
+        sched->callback = NULL;
+    }
+    sched->dirty = 0;
+}
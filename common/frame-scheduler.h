@@ -0,0 +1,48 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <wayland-client.h>
+
+/*
+ * Renders a surface at most once per compositor frame. Event handlers call
+ * frame_scheduler_schedule() whenever state changes. The first change
+ * after an idle period renders at once; changes that arrive while a
+ * wl_surface.frame callback is pending are coalesced into one render when
+ * it fires.
+ *
+ * render must commit the surface. It returns 0 once it has drawn
+ * everything, or -1 when it could not (e.g. no free buffer) and wants
+ * another go next frame.
+ */
+typedef int (*frame_render_func)(void *data);
+
+struct frame_scheduler {
+    struct wl_surface *surface;
+    struct wl_callback *callback;
+    frame_render_func render;
+    void *data;
+    int dirty;
+
+    uint32_t last_time;
+    double interval_ms;
+    double frame_start_ms;
+
+    unsigned long frames;
+    unsigned long coalesced;
+    /* least frame_scheduler_budget_ms() left after any render */
+    double min_budget_ms;
+};
+
+void frame_scheduler_init(struct frame_scheduler *sched,
+                          struct wl_surface *surface,
+                          frame_render_func render, void *data);
+void frame_scheduler_schedule(struct frame_scheduler *sched);
+double frame_scheduler_budget_ms(const struct frame_scheduler *sched);
+/* One line: frames rendered, changes coalesced and the tightest budget. */
+void frame_scheduler_print_stats(const struct frame_scheduler *sched,
+                                 FILE *out, const char *label);
+void frame_scheduler_finish(struct frame_scheduler *sched);
+
+#endif
@@ -0,0 +1,71 @@
+#include <stdlib.h>
+
+#include "latency-stats.h"
+
+void latency_stats_init(struct latency_stats *stats) {
+    stats->samples = NULL;
+    stats->count = 0;
+    stats->capacity = 0;
+    stats->max_ns = 0;
+}
+
+void latency_stats_add(struct latency_stats *stats, uint64_t ns) {
+    if (ns > stats->max_ns) {
+        stats->max_ns = ns;
+    }
+    if (stats->count == stats->capacity) {
+        size_t capacity = stats->capacity ? stats->capacity * 2 : 1024;
+        uint64_t *samples =
+            realloc(stats->samples, capacity * sizeof(*samples));
+        if (!samples) {
+            return;
+        }
+        stats->samples = samples;
+        stats->capacity = capacity;
+    }
+    stats->samples[stats->count++] = ns;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+uint64_t latency_stats_percentile(struct latency_stats *stats, double p) {
+    if (!stats->count) {
+        return 0;
+    }
+    qsort(stats->samples, stats->count, sizeof(*stats->samples), compare_u64);
+    // Nearest rank
+    size_t rank = (size_t)(p / 100.0 * stats->count + 0.5);
+    if (rank > 0) {
+        rank--;
+    }
+    if (rank >= stats->count) {
+        rank = stats->count - 1;
+    }
+    return stats->samples[rank];
+}
+
+void latency_stats_print(struct latency_stats *stats, FILE *out,
+                         const char *label) {
+    if (!stats->count) {
+        fprintf(out, "%s samples=0\n", label);
+        return;
+    }
+    uint64_t sum = 0;
+    for (size_t i = 0; i < stats->count; i++) {
+        sum += stats->samples[i];
+    }
+    uint64_t p50 = latency_stats_percentile(stats, 50);
+    uint64_t p99 = latency_stats_percentile(stats, 99);
+    fprintf(out, "%s samples=%zu mean=%.1fus p50=%.1fus p99=%.1fus max=%.1fus\n",
+            label, stats->count, sum / 1e3 / stats->count, p50 / 1e3,
+            p99 / 1e3, stats->max_ns / 1e3);
+}
+
+void latency_stats_finish(struct latency_stats *stats) {
+    free(stats->samples);
+    latency_stats_init(stats);
+}
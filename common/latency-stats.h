@@ -0,0 +1,28 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Collects latency samples in nanoseconds so percentiles can be reported
+ * at the end of a run. The sample array grows by doubling; a failed
+ * allocation drops the sample but still counts it towards max.
+ */
+struct latency_stats {
+    uint64_t *samples;
+    size_t count;
+    size_t capacity;
+    uint64_t max_ns;
+};
+
+void latency_stats_init(struct latency_stats *stats);
+void latency_stats_add(struct latency_stats *stats, uint64_t ns);
+// p is in [0, 100]; sorts the samples in place
+uint64_t latency_stats_percentile(struct latency_stats *stats, double p);
+void latency_stats_print(struct latency_stats *stats, FILE *out,
+                         const char *label);
+void latency_stats_finish(struct latency_stats *stats);
+
+#endif
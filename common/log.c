@@ -0,0 +1,226 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log.h"
+
+// Bounded multi-producer queue: a slot is free for the producer at
+// position pos when its seq equals pos, and holds a message for the
+// consumer when seq is pos + 1.
+struct log_entry {
+    atomic_size_t seq;
+    enum log_level level;
+    uint64_t time_ms;
+    char text[LOG_LINE_MAX];
+};
+
+static struct log_entry entries[LOG_QUEUE_SIZE];
+static atomic_size_t enqueue_pos;
+static size_t dequeue_pos;
+static atomic_ulong dropped;
+
+static enum log_level threshold = LOG_LEVEL_INFO;
+static atomic_int running;
+static atomic_int wake_pending;
+static int wake_fd = -1;
+static pthread_t thread;
+// serialises consumers: the drain thread and log_finish()
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic uint64_t start_ms;
+
+static const char *level_names[] = {"error", "warn", "info", "debug"};
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000ull + ts.tv_nsec / 1000000;
+}
+
+static void print_line(enum log_level level, uint64_t time_ms,
+                       const char *text) {
+    uint64_t since = time_ms - atomic_load(&start_ms);
+    fprintf(stderr, "[%6llu.%03llu] %s: %s\n",
+            (unsigned long long)since / 1000,
+            (unsigned long long)since % 1000, level_names[level], text);
+}
+
+static void drain(void) {
+    pthread_mutex_lock(&drain_lock);
+    for (;;) {
+        struct log_entry *entry = &entries[dequeue_pos % LOG_QUEUE_SIZE];
+        if (atomic_load_explicit(&entry->seq, memory_order_acquire) !=
+            dequeue_pos + 1) {
+            break;
+        }
+        print_line(entry->level, entry->time_ms, entry->text);
+        atomic_store_explicit(&entry->seq, dequeue_pos + LOG_QUEUE_SIZE,
+                              memory_order_release);
+        dequeue_pos++;
+    }
+    unsigned long lost = atomic_exchange(&dropped, 0);
+    if (lost) {
+        fprintf(stderr, "log queue full, dropped %lu messages\n", lost);
+    }
+    fflush(stderr);
+    pthread_mutex_unlock(&drain_lock);
+}
+
+static void *drain_thread(void *data) {
+    (void)data;
+    while (atomic_load(&running)) {
+        struct pollfd pfd = {.fd = wake_fd, .events = POLLIN};
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+            break;
+        }
+        uint64_t value;
+        if (read(wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+            break;
+        }
+        atomic_store(&wake_pending, 0);
+        drain();
+    }
+    return NULL;
+}
+
+static int enqueue(enum log_level level, uint64_t time_ms, const char *text) {
+    size_t pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+    struct log_entry *entry;
+    for (;;) {
+        entry = &entries[pos % LOG_QUEUE_SIZE];
+        size_t seq = atomic_load_explicit(&entry->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(
+                    &enqueue_pos, &pos, pos + 1, memory_order_relaxed,
+                    memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        }
+    }
+    entry->level = level;
+    entry->time_ms = time_ms;
+    memcpy(entry->text, text, LOG_LINE_MAX);
+    atomic_store_explicit(&entry->seq, pos + 1, memory_order_release);
+
+    // One wakeup per drain, not per message
+    if (!atomic_exchange(&wake_pending, 1)) {
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0) {
+            // the counter is far from overflowing; nothing to do
+        }
+    }
+    return 0;
+}
+
+static int ratelimit_allow(struct log_ratelimit *ratelimit, uint64_t time_ms,
+                           unsigned *suppressed) {
+    uint64_t start = atomic_load(&ratelimit->window_start_ms);
+    if (time_ms - start >= LOG_RATELIMIT_INTERVAL_MS &&
+        atomic_compare_exchange_strong(&ratelimit->window_start_ms, &start,
+                                       time_ms)) {
+        atomic_store(&ratelimit->count, 0);
+        *suppressed = atomic_exchange(&ratelimit->suppressed, 0);
+    }
+    if (atomic_fetch_add(&ratelimit->count, 1) < LOG_RATELIMIT_BURST) {
+        return 1;
+    }
+    atomic_fetch_add(&ratelimit->suppressed, 1);
+    return 0;
+}
+
+void log_write(enum log_level level, struct log_ratelimit *ratelimit,
+               const char *format, ...) {
+    if (level > threshold) {
+        return;
+    }
+    uint64_t time_ms = now_ms();
+    // timestamps count from the first message or log_init()
+    uint64_t unset = 0;
+    atomic_compare_exchange_strong(&start_ms, &unset, time_ms);
+    unsigned suppressed = 0;
+    if (!ratelimit_allow(ratelimit, time_ms, &suppressed)) {
+        return;
+    }
+
+    char text[LOG_LINE_MAX];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (suppressed && len >= 0 && len < LOG_LINE_MAX) {
+        snprintf(text + len, sizeof(text) - len, " (%u similar suppressed)",
+                 suppressed);
+    }
+
+    if (!atomic_load_explicit(&running, memory_order_acquire)) {
+        print_line(level, time_ms, text);
+        return;
+    }
+    if (enqueue(level, time_ms, text) < 0) {
+        atomic_fetch_add(&dropped, 1);
+    }
+}
+
+int log_init(void) {
+    const char *env = getenv("DEMOS_LOG_LEVEL");
+    if (env) {
+        for (int i = 0; i <= LOG_LEVEL_DEBUG; i++) {
+            if (!strcasecmp(env, level_names[i])) {
+                threshold = i;
+            }
+        }
+    }
+    atomic_store(&start_ms, now_ms());
+    for (size_t i = 0; i < LOG_QUEUE_SIZE; i++) {
+        atomic_init(&entries[i].seq, i);
+    }
+
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd < 0) {
+        perror("eventfd");
+        return -1;
+    }
+    // The drain thread must not take signals meant for the event loop
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    atomic_store(&running, 1);
+    int ret = pthread_create(&thread, NULL, drain_thread, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (ret != 0) {
+        fprintf(stderr, "pthread_create: %s\n", strerror(ret));
+        atomic_store(&running, 0);
+        close(wake_fd);
+        wake_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+void log_finish(void) {
+    if (!atomic_exchange(&running, 0)) {
+        return;
+    }
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0) {
+        perror("write");
+    }
+    pthread_join(thread, NULL);
+    drain();
+    close(wake_fd);
+    wake_fd = -1;
+}
@@ -0,0 +1,55 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*
+ * Logging for event handlers. log_write() only formats the message into
+ * a slot of a fixed lock-free queue; a background thread started by
+ * log_init() writes the slots to stderr. A handler therefore never blocks
+ * on the terminal. If the queue is full the message is dropped and
+ * counted. Before log_init(), and after log_finish(), messages are
+ * written directly.
+ *
+ * Each call site is rate-limited to LOG_RATELIMIT_BURST messages per
+ * LOG_RATELIMIT_INTERVAL_MS. The next message that gets through reports
+ * how many were suppressed. $DEMOS_LOG_LEVEL (error, warn, info or
+ * debug) sets the threshold; the default is info.
+ */
+#define LOG_QUEUE_SIZE 256
+#define LOG_LINE_MAX 160
+#define LOG_RATELIMIT_BURST 10
+#define LOG_RATELIMIT_INTERVAL_MS 1000
+
+enum log_level {
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG,
+};
+
+struct log_ratelimit {
+    _Atomic uint64_t window_start_ms;
+    atomic_uint count;
+    atomic_uint suppressed;
+};
+
+int log_init(void);
+void log_finish(void);
+void log_write(enum log_level level, struct log_ratelimit *ratelimit,
+               const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define LOG_AT(level, ...)                                  \
+    do {                                                    \
+        static struct log_ratelimit log_ratelimit_;         \
+        log_write(level, &log_ratelimit_, __VA_ARGS__);     \
+    } while (0)
+
+#define log_error(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define log_warn(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define log_info(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define log_debug(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#endif
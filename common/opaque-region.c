@@ -0,0 +1,53 @@
+#include <string.h>
+
+#include "opaque-region.h"
+#include "shm-format.h"
+
+void opaque_region_init(struct opaque_region *opaque,
+                        struct wl_compositor *compositor,
+                        struct wl_surface *surface) {
+    memset(opaque, 0, sizeof(*opaque));
+    opaque->compositor = compositor;
+    opaque->surface = surface;
+}
+
+void opaque_region_set(struct opaque_region *opaque, int x, int y, int width,
+                       int height) {
+    if (width <= 0 || height <= 0) {
+        x = y = width = height = 0;
+    }
+    if (!shm_format_use_opaque() ||
+        (x == opaque->x && y == opaque->y && width == opaque->width &&
+         height == opaque->height)) {
+        return;
+    }
+    opaque->x = x;
+    opaque->y = y;
+    opaque->width = width;
+    opaque->height = height;
+
+    if (!width) {
+        wl_surface_set_opaque_region(opaque->surface, NULL);
+        return;
+    }
+    struct wl_region *region = wl_compositor_create_region(opaque->compositor);
+    wl_region_add(region, x, y, width, height);
+    wl_surface_set_opaque_region(opaque->surface, region);
+    wl_region_destroy(region);
+}
+
+void opaque_region_from_renderer(struct opaque_region *opaque,
+                                 const struct renderer *renderer, int width,
+                                 int height) {
+    int x, y, w, h;
+    if (!renderer_opaque_rect(renderer, &x, &y, &w, &h)) {
+        return;
+    }
+    if (x + w > width) {
+        w = width - x;
+    }
+    if (y + h > height) {
+        h = height - y;
+    }
+    opaque_region_set(opaque, x, y, w, h);
+}
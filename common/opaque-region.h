@@ -0,0 +1,35 @@
+#ifndef OPAQUE_REGION_H
+#define OPAQUE_REGION_H
+
+#include <wayland-client.h>
+
+#include "renderer.h"
+
+/*
+ * The opaque region of one surface, in surface coordinates. It is sent
+ * with wl_surface_set_opaque_region only when it changes, and like the
+ * rest of the surface state takes effect on the next commit. Nothing is
+ * sent when $DEMOS_OPAQUE is 0 (see shm-format.h).
+ */
+struct opaque_region {
+    struct wl_compositor *compositor;
+    struct wl_surface *surface;
+    int x, y, width, height;
+};
+
+void opaque_region_init(struct opaque_region *opaque,
+                        struct wl_compositor *compositor,
+                        struct wl_surface *surface);
+/* An empty rect clears the region. */
+void opaque_region_set(struct opaque_region *opaque, int x, int y, int width,
+                       int height);
+/*
+ * Takes the region from renderer_opaque_rect(), clipped to the surface
+ * size, for a buffer shown 1:1 from its origin. A frame that drew nothing
+ * leaves the region alone.
+ */
+void opaque_region_from_renderer(struct opaque_region *opaque,
+                                 const struct renderer *renderer, int width,
+                                 int height);
+
+#endif
@@ -0,0 +1,239 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86 1
+#endif
+
+#include "pattern-fill.h"
+
+/*
+ * Row kernels fill row[x0, x1) where row points at pixel 0 of the row.
+ * A row is made of CHECKER_CELL long runs alternating between a and b,
+ * starting with a at x = 0.
+ */
+typedef void (*fill_row_func)(uint32_t *row, int x0, int x1, uint32_t a,
+                              uint32_t b);
+
+#define PERIOD (2 * CHECKER_CELL)
+
+static void fill_row_scalar(uint32_t *row, int x0, int x1, uint32_t a,
+                            uint32_t b) {
+    for (int x = x0; x < x1; x++) {
+        row[x] = (x & CHECKER_CELL) ? b : a;
+    }
+}
+
+#ifdef HAVE_X86
+__attribute__((target("sse2")))
+static void fill_row_sse2(uint32_t *row, int x0, int x1, uint32_t a,
+                          uint32_t b) {
+    int x = (x0 + PERIOD - 1) / PERIOD * PERIOD;
+    if (x > x1) {
+        x = x1;
+    }
+    fill_row_scalar(row, x0, x, a, b);
+
+    __m128i va = _mm_set1_epi32(a);
+    __m128i vb = _mm_set1_epi32(b);
+    for (; x + PERIOD <= x1; x += PERIOD) {
+        _mm_storeu_si128((__m128i *)(row + x), va);
+        _mm_storeu_si128((__m128i *)(row + x + 4), va);
+        _mm_storeu_si128((__m128i *)(row + x + 8), vb);
+        _mm_storeu_si128((__m128i *)(row + x + 12), vb);
+    }
+    fill_row_scalar(row, x, x1, a, b);
+}
+
+__attribute__((target("avx2")))
+static void fill_row_avx2(uint32_t *row, int x0, int x1, uint32_t a,
+                          uint32_t b) {
+    int x = (x0 + PERIOD - 1) / PERIOD * PERIOD;
+    if (x > x1) {
+        x = x1;
+    }
+    fill_row_scalar(row, x0, x, a, b);
+
+    __m256i va = _mm256_set1_epi32(a);
+    __m256i vb = _mm256_set1_epi32(b);
+    for (; x + PERIOD <= x1; x += PERIOD) {
+        _mm256_storeu_si256((__m256i *)(row + x), va);
+        _mm256_storeu_si256((__m256i *)(row + x + 8), vb);
+    }
+    fill_row_scalar(row, x, x1, a, b);
+}
+#endif
+
+static fill_row_func fill_row;
+static const char *fill_row_name;
+
+#ifdef HAVE_X86
+// Scratch rows AUTO times the kernels on: a 1080p wide strip, big enough
+// that stores go past L1 like they do on a real frame.
+#define CALIBRATE_WIDTH 1920
+#define CALIBRATE_ROWS 32
+#define CALIBRATE_RUNS 5
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Best of a few runs, so a preemption doesn't decide the kernel.
+static double time_kernel(fill_row_func kernel, uint32_t *rows) {
+    double best = 0;
+    for (int run = 0; run < CALIBRATE_RUNS; run++) {
+        double start = now_ns();
+        for (int row = 0; row < CALIBRATE_ROWS; row++) {
+            kernel(rows + row * CALIBRATE_WIDTH, 0, CALIBRATE_WIDTH,
+                   0xFF666666, 0xFFEEEEEE);
+        }
+        double elapsed = now_ns() - start;
+        if (run == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+// Wider is not always faster: checker-bench has SSE2 ahead of AVX2 at
+// every size on some CPUs, where the fill is bound by stores rather than
+// by instructions. So time the vector kernels and keep the faster one.
+static enum pattern_fill_isa calibrate(int avx2, int sse2) {
+    if (!avx2) {
+        return sse2 ? PATTERN_FILL_SSE2 : PATTERN_FILL_SCALAR;
+    }
+    uint32_t *rows = malloc(sizeof(uint32_t) * CALIBRATE_WIDTH *
+                            CALIBRATE_ROWS);
+    if (!rows || !sse2) {
+        free(rows);
+        return PATTERN_FILL_AVX2;
+    }
+    // the first pass also faults the pages in
+    time_kernel(fill_row_sse2, rows);
+    double sse2_ns = time_kernel(fill_row_sse2, rows);
+    double avx2_ns = time_kernel(fill_row_avx2, rows);
+    free(rows);
+    return avx2_ns < sse2_ns ? PATTERN_FILL_AVX2 : PATTERN_FILL_SSE2;
+}
+#endif
+
+int pattern_fill_set_isa(enum pattern_fill_isa isa) {
+#ifdef HAVE_X86
+    __builtin_cpu_init();
+    int avx2 = __builtin_cpu_supports("avx2");
+    int sse2 = __builtin_cpu_supports("sse2");
+    if (isa == PATTERN_FILL_AUTO) {
+        isa = calibrate(avx2, sse2);
+    }
+#else
+    if (isa == PATTERN_FILL_AUTO) {
+        isa = PATTERN_FILL_SCALAR;
+    }
+#endif
+
+    switch (isa) {
+#ifdef HAVE_X86
+    case PATTERN_FILL_AVX2:
+        if (!avx2) {
+            return -1;
+        }
+        fill_row = fill_row_avx2;
+        fill_row_name = "avx2";
+        return 0;
+    case PATTERN_FILL_SSE2:
+        if (!sse2) {
+            return -1;
+        }
+        fill_row = fill_row_sse2;
+        fill_row_name = "sse2";
+        return 0;
+#endif
+    case PATTERN_FILL_SCALAR:
+        fill_row = fill_row_scalar;
+        fill_row_name = "scalar";
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+const char *pattern_fill_isa_name(void) {
+    if (!fill_row) {
+        pattern_fill_set_isa(PATTERN_FILL_AUTO);
+    }
+    return fill_row_name;
+}
+
+void pattern_fill_checker(uint32_t *pixels, int stride, int x, int y, int w,
+                          int h, uint32_t first, uint32_t second) {
+    if (!fill_row) {
+        pattern_fill_set_isa(PATTERN_FILL_AUTO);
+    }
+
+    for (int row = y; row < y + h; row++) {
+        uint32_t *line = pixels + (size_t)row * stride;
+        // every other band of CHECKER_CELL rows starts with the second colour
+        if (row & CHECKER_CELL) {
+            fill_row(line, x, x + w, second, first);
+        } else {
+            fill_row(line, x, x + w, first, second);
+        }
+    }
+}
+
+void pattern_fill_solid(uint32_t *pixels, int stride, int x, int y, int w,
+                        int h, uint32_t color) {
+    if (!fill_row) {
+        pattern_fill_set_isa(PATTERN_FILL_AUTO);
+    }
+
+    for (int row = y; row < y + h; row++) {
+        fill_row(pixels + (size_t)row * stride, x, x + w, color, color);
+    }
+}
+
+// One period of the row, copied in PERIOD sized blocks the compiler turns
+// into vector stores; a plain per-pixel select does not vectorise at -O2.
+static void fill_row16(uint16_t *row, int x0, int x1, uint16_t a, uint16_t b) {
+    uint16_t period[PERIOD];
+    for (int i = 0; i < PERIOD; i++) {
+        period[i] = (i & CHECKER_CELL) ? b : a;
+    }
+    int x = x0;
+    for (; x < x1 && x % PERIOD; x++) {
+        row[x] = period[x % PERIOD];
+    }
+    for (; x + PERIOD <= x1; x += PERIOD) {
+        memcpy(row + x, period, sizeof(period));
+    }
+    for (; x < x1; x++) {
+        row[x] = period[x % PERIOD];
+    }
+}
+
+void pattern_fill_checker16(uint16_t *pixels, int stride, int x, int y, int w,
+                            int h, uint32_t first, uint32_t second) {
+    uint16_t a = pattern_fill_rgb565(first);
+    uint16_t b = pattern_fill_rgb565(second);
+    for (int row = y; row < y + h; row++) {
+        uint16_t *line = pixels + (size_t)row * stride;
+        if (row & CHECKER_CELL) {
+            fill_row16(line, x, x + w, b, a);
+        } else {
+            fill_row16(line, x, x + w, a, b);
+        }
+    }
+}
+
+void pattern_fill_solid16(uint16_t *pixels, int stride, int x, int y, int w,
+                          int h, uint32_t color) {
+    uint16_t c = pattern_fill_rgb565(color);
+    for (int row = y; row < y + h; row++) {
+        fill_row16(pixels + (size_t)row * stride, x, x + w, c, c);
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef PATTERN_FILL_H
+#define PATTERN_FILL_H
+
+#include <stdint.h>
+
+/* Side of one chess board square, in pixels. */
+#define CHECKER_CELL 8
+
+enum pattern_fill_isa {
+    PATTERN_FILL_AUTO,
+    PATTERN_FILL_SCALAR,
+    PATTERN_FILL_SSE2,
+    PATTERN_FILL_AVX2,
+};
+
+/*
+ * Fill the rectangle (x, y, w, h) of a 32bpp buffer with the chess board
+ * pattern. The pattern is anchored at the buffer origin, so any sub-rect
+ * can be redrawn on its own. stride is in pixels.
+ */
+void pattern_fill_checker(uint32_t *pixels, int stride, int x, int y, int w,
+                          int h, uint32_t first, uint32_t second);
+
+/* Fill (x, y, w, h) with a single colour, using the same kernels. */
+void pattern_fill_solid(uint32_t *pixels, int stride, int x, int y, int w,
+                        int h, uint32_t color);
+
+/*
+ * The same two fills for an RGB565 buffer (stride in pixels). They are
+ * plain loops the compiler vectorises on its own. Colours are still given
+ * as ARGB8888 and converted with pattern_fill_rgb565().
+ */
+void pattern_fill_checker16(uint16_t *pixels, int stride, int x, int y, int w,
+                            int h, uint32_t first, uint32_t second);
+void pattern_fill_solid16(uint16_t *pixels, int stride, int x, int y, int w,
+                          int h, uint32_t color);
+
+static inline uint16_t pattern_fill_rgb565(uint32_t argb) {
+    return ((argb >> 8) & 0xF800) | ((argb >> 5) & 0x07E0) |
+           ((argb >> 3) & 0x001F);
+}
+
+/*
+ * Pick the kernel used by pattern_fill_checker(). AUTO, the default, times
+ * the kernels the CPU supports on a scratch strip and keeps the fastest.
+ * Returns -1 if the CPU cannot run the requested kernel.
+ */
+int pattern_fill_set_isa(enum pattern_fill_isa isa);
+const char *pattern_fill_isa_name(void);
+
+#endif
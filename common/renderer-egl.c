@@ -0,0 +1,284 @@
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "pattern-fill.h"
+#include "renderer.h"
+
+// Drawn rects read back at end_frame; more than this flushes early
+#define DIRTY_MAX 16
+
+extern const struct renderer_impl renderer_egl_impl;
+
+struct egl_renderer {
+    struct renderer base;
+    EGLDisplay display;
+    EGLContext context;
+    GLuint framebuffer, renderbuffer;
+    int fb_width, fb_height;
+    GLuint program;
+    GLint first_loc, second_loc;
+    struct {
+        int x, y, w, h;
+    } dirty[DIRTY_MAX];
+    int dirty_count;
+};
+
+// A triangle covering the viewport, no vertex buffer needed
+static const char *vertex_source =
+    "#version 300 es\n"
+    "void main() {\n"
+    "    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+    "    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+// Framebuffer row n holds buffer row n, so gl_FragCoord is already in
+// buffer coordinates.
+static const char *fragment_source =
+    "#version 300 es\n"
+    "precision highp float;\n"
+    "uniform vec4 first;\n"
+    "uniform vec4 second;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "    ivec2 p = ivec2(gl_FragCoord.xy);\n"
+    "    color = ((p.x ^ p.y) & CELL) != 0 ? second : first;\n"
+    "}\n";
+
+// GL_RGBA readback stores bytes in R, G, B, A order while ARGB8888 is
+// B, G, R, A in memory, so red and blue trade places.
+static void to_rgba(uint32_t argb, GLfloat rgba[4]) {
+    rgba[0] = (argb & 0xFF) / 255.0f;
+    rgba[1] = ((argb >> 8) & 0xFF) / 255.0f;
+    rgba[2] = ((argb >> 16) & 0xFF) / 255.0f;
+    rgba[3] = (argb >> 24) / 255.0f;
+}
+
+static GLuint compile(GLenum type, const char *source) {
+    char cell[64];
+    snprintf(cell, sizeof(cell), "#define CELL %d\n", CHECKER_CELL);
+    // the #version line has to stay first
+    const char *newline = strchr(source, '\n') + 1;
+    const char *parts[] = {source, cell, newline};
+    GLint lengths[] = {newline - source, -1, -1};
+
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 3, parts, lengths);
+    glCompileShader(shader);
+    GLint ok;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[512];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        log_error("shader compile failed: %s", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static int create_program(struct egl_renderer *er) {
+    GLuint vertex = compile(GL_VERTEX_SHADER, vertex_source);
+    GLuint fragment = compile(GL_FRAGMENT_SHADER, fragment_source);
+    if (!vertex || !fragment) {
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        return -1;
+    }
+    er->program = glCreateProgram();
+    glAttachShader(er->program, vertex);
+    glAttachShader(er->program, fragment);
+    glLinkProgram(er->program);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    GLint ok;
+    glGetProgramiv(er->program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        log_error("shader link failed");
+        return -1;
+    }
+    er->first_loc = glGetUniformLocation(er->program, "first");
+    er->second_loc = glGetUniformLocation(er->program, "second");
+    return 0;
+}
+
+static void egl_destroy(struct renderer *renderer);
+
+static struct renderer *egl_create(void) {
+    const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+            "eglGetPlatformDisplayEXT");
+    if (!extensions || !strstr(extensions, "EGL_MESA_platform_surfaceless") ||
+        !get_platform_display) {
+        log_error("EGL has no surfaceless platform");
+        return NULL;
+    }
+
+    struct egl_renderer *er = calloc(1, sizeof(*er));
+    if (!er) {
+        perror("calloc");
+        return NULL;
+    }
+    er->base.impl = &renderer_egl_impl;
+    er->context = EGL_NO_CONTEXT;
+
+    er->display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                       EGL_DEFAULT_DISPLAY, NULL);
+    if (er->display == EGL_NO_DISPLAY ||
+        !eglInitialize(er->display, NULL, NULL)) {
+        log_error("failed to initialize the surfaceless EGL display");
+        er->display = EGL_NO_DISPLAY;
+        egl_destroy(&er->base);
+        return NULL;
+    }
+
+    // the default surface type is EGL_WINDOW_BIT, which surfaceless
+    // displays have no configs for
+    static const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+        EGL_NONE,
+    };
+    static const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3, EGL_NONE,
+    };
+    EGLConfig config;
+    EGLint count = 0;
+    eglBindAPI(EGL_OPENGL_ES_API);
+    if (!eglChooseConfig(er->display, config_attribs, &config, 1, &count) ||
+        count == 0) {
+        log_error("no EGL config for GLES 3");
+        egl_destroy(&er->base);
+        return NULL;
+    }
+    er->context = eglCreateContext(er->display, config, EGL_NO_CONTEXT,
+                                   context_attribs);
+    if (er->context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(er->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                        er->context)) {
+        log_error("failed to make a surfaceless GLES 3 context current");
+        egl_destroy(&er->base);
+        return NULL;
+    }
+    log_info("egl renderer on %s", (const char *)glGetString(GL_RENDERER));
+
+    if (create_program(er) < 0) {
+        egl_destroy(&er->base);
+        return NULL;
+    }
+    glGenFramebuffers(1, &er->framebuffer);
+    glGenRenderbuffers(1, &er->renderbuffer);
+    glEnable(GL_SCISSOR_TEST);
+    return &er->base;
+}
+
+static void egl_destroy(struct renderer *renderer) {
+    struct egl_renderer *er = (struct egl_renderer *)renderer;
+    if (er->context != EGL_NO_CONTEXT) {
+        glDeleteProgram(er->program);
+        glDeleteFramebuffers(1, &er->framebuffer);
+        glDeleteRenderbuffers(1, &er->renderbuffer);
+        eglMakeCurrent(er->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                       EGL_NO_CONTEXT);
+        eglDestroyContext(er->display, er->context);
+    }
+    if (er->display != EGL_NO_DISPLAY) {
+        eglTerminate(er->display);
+    }
+    free(er);
+}
+
+static void egl_begin_frame(struct renderer *renderer) {
+    struct egl_renderer *er = (struct egl_renderer *)renderer;
+    // the framebuffer only grows, like the shm pool behind it
+    if (renderer->width > er->fb_width || renderer->height > er->fb_height) {
+        if (renderer->width > er->fb_width) {
+            er->fb_width = renderer->width;
+        }
+        if (renderer->height > er->fb_height) {
+            er->fb_height = renderer->height;
+        }
+        glBindRenderbuffer(GL_RENDERBUFFER, er->renderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, er->fb_width,
+                              er->fb_height);
+        glBindFramebuffer(GL_FRAMEBUFFER, er->framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                  GL_RENDERBUFFER, er->renderbuffer);
+    }
+    glViewport(0, 0, renderer->width, renderer->height);
+    er->dirty_count = 0;
+}
+
+static void read_back(struct egl_renderer *er) {
+    struct renderer *renderer = &er->base;
+    glPixelStorei(GL_PACK_ROW_LENGTH, renderer->stride);
+    for (int i = 0; i < er->dirty_count; i++) {
+        int x = er->dirty[i].x, y = er->dirty[i].y;
+        glReadPixels(x, y, er->dirty[i].w, er->dirty[i].h, GL_RGBA,
+                     GL_UNSIGNED_BYTE,
+                     renderer->pixels + (size_t)y * renderer->stride + x);
+    }
+    er->dirty_count = 0;
+}
+
+static void add_dirty(struct egl_renderer *er, int x, int y, int w, int h) {
+    if (er->dirty_count == DIRTY_MAX) {
+        read_back(er);
+    }
+    er->dirty[er->dirty_count].x = x;
+    er->dirty[er->dirty_count].y = y;
+    er->dirty[er->dirty_count].w = w;
+    er->dirty[er->dirty_count].h = h;
+    er->dirty_count++;
+}
+
+static void egl_fill_rect(struct renderer *renderer, int x, int y, int w,
+                          int h, uint32_t color) {
+    struct egl_renderer *er = (struct egl_renderer *)renderer;
+    GLfloat rgba[4];
+    to_rgba(color, rgba);
+    glScissor(x, y, w, h);
+    glClearColor(rgba[0], rgba[1], rgba[2], rgba[3]);
+    glClear(GL_COLOR_BUFFER_BIT);
+    add_dirty(er, x, y, w, h);
+}
+
+static void egl_checker(struct renderer *renderer, int x, int y, int w, int h,
+                        uint32_t first, uint32_t second) {
+    struct egl_renderer *er = (struct egl_renderer *)renderer;
+    GLfloat rgba[4];
+    glUseProgram(er->program);
+    to_rgba(first, rgba);
+    glUniform4fv(er->first_loc, 1, rgba);
+    to_rgba(second, rgba);
+    glUniform4fv(er->second_loc, 1, rgba);
+    glScissor(x, y, w, h);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    add_dirty(er, x, y, w, h);
+}
+
+static int egl_end_frame(struct renderer *renderer) {
+    struct egl_renderer *er = (struct egl_renderer *)renderer;
+    read_back(er);
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        log_error("GL error 0x%x", error);
+        return -1;
+    }
+    return 0;
+}
+
+const struct renderer_impl renderer_egl_impl = {
+    .name = "egl",
+    .create = egl_create,
+    .destroy = egl_destroy,
+    .begin_frame = egl_begin_frame,
+    .fill_rect = egl_fill_rect,
+    .checker = egl_checker,
+    .end_frame = egl_end_frame,
+};
@@ -0,0 +1,129 @@
+#include <pixman.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "log.h"
+#include "pattern-fill.h"
+#include "renderer.h"
+
+#define PATTERN_SIZE (2 * CHECKER_CELL)
+
+extern const struct renderer_impl renderer_pixman_impl;
+
+struct pixman_renderer {
+    struct renderer base;
+    pixman_image_t *target;
+    // one period of the board, drawn with PIXMAN_REPEAT_NORMAL
+    pixman_image_t *pattern;
+    uint32_t pattern_first, pattern_second;
+};
+
+static pixman_color_t to_color(uint32_t argb) {
+    // pixman colours are 16 bits per channel
+    pixman_color_t color = {
+        .red = ((argb >> 16) & 0xFF) * 0x101,
+        .green = ((argb >> 8) & 0xFF) * 0x101,
+        .blue = (argb & 0xFF) * 0x101,
+        .alpha = (argb >> 24) * 0x101,
+    };
+    return color;
+}
+
+static struct renderer *pixman_create(void) {
+    struct pixman_renderer *pr = calloc(1, sizeof(*pr));
+    if (!pr) {
+        perror("calloc");
+        return NULL;
+    }
+    pr->pattern = pixman_image_create_bits(PIXMAN_a8r8g8b8, PATTERN_SIZE,
+                                           PATTERN_SIZE, NULL, 0);
+    if (!pr->pattern) {
+        log_error("failed to create the pixman pattern image");
+        free(pr);
+        return NULL;
+    }
+    pixman_image_set_repeat(pr->pattern, PIXMAN_REPEAT_NORMAL);
+    pr->base.impl = &renderer_pixman_impl;
+    return &pr->base;
+}
+
+static void pixman_destroy(struct renderer *renderer) {
+    struct pixman_renderer *pr = (struct pixman_renderer *)renderer;
+    if (pr->target) {
+        pixman_image_unref(pr->target);
+    }
+    pixman_image_unref(pr->pattern);
+    free(pr);
+}
+
+static void pixman_begin_frame(struct renderer *renderer) {
+    struct pixman_renderer *pr = (struct pixman_renderer *)renderer;
+    // pixman converts to the target format itself
+    uint32_t *bits = renderer->pixels16 ? (uint32_t *)renderer->pixels16
+                                        : renderer->pixels;
+    pixman_format_code_t format =
+        renderer->pixels16 ? PIXMAN_r5g6b5 : PIXMAN_a8r8g8b8;
+    int stride = renderer->stride * (renderer->pixels16 ? 2 : 4);
+    if (pr->target) {
+        // the same slot comes back every few frames, keep its image
+        if (pixman_image_get_data(pr->target) == bits &&
+            pixman_image_get_format(pr->target) == format &&
+            pixman_image_get_width(pr->target) == renderer->width &&
+            pixman_image_get_height(pr->target) == renderer->height &&
+            pixman_image_get_stride(pr->target) == stride) {
+            return;
+        }
+        pixman_image_unref(pr->target);
+    }
+    pr->target = pixman_image_create_bits(format, renderer->width,
+                                          renderer->height, bits, stride);
+    if (!pr->target) {
+        log_error("failed to wrap the buffer in a pixman image");
+    }
+}
+
+static void pixman_fill_rect(struct renderer *renderer, int x, int y, int w,
+                             int h, uint32_t color) {
+    struct pixman_renderer *pr = (struct pixman_renderer *)renderer;
+    if (!pr->target) {
+        return;
+    }
+    pixman_color_t c = to_color(color);
+    pixman_box32_t box = {x, y, x + w, y + h};
+    pixman_image_fill_boxes(PIXMAN_OP_SRC, pr->target, &c, 1, &box);
+}
+
+static void pixman_checker(struct renderer *renderer, int x, int y, int w,
+                           int h, uint32_t first, uint32_t second) {
+    struct pixman_renderer *pr = (struct pixman_renderer *)renderer;
+    if (!pr->target) {
+        return;
+    }
+    if (pr->pattern_first != first || pr->pattern_second != second) {
+        pattern_fill_checker(pixman_image_get_data(pr->pattern),
+                             pixman_image_get_stride(pr->pattern) / 4, 0, 0,
+                             PATTERN_SIZE, PATTERN_SIZE, first, second);
+        pr->pattern_first = first;
+        pr->pattern_second = second;
+    }
+    // source and destination share coordinates, which keeps the repeated
+    // pattern anchored at the buffer origin
+    pixman_image_composite32(PIXMAN_OP_SRC, pr->pattern, NULL, pr->target, x,
+                             y, 0, 0, x, y, w, h);
+}
+
+static int pixman_end_frame(struct renderer *renderer) {
+    struct pixman_renderer *pr = (struct pixman_renderer *)renderer;
+    return pr->target ? 0 : -1;
+}
+
+const struct renderer_impl renderer_pixman_impl = {
+    .name = "pixman",
+    .rgb565 = 1,
+    .create = pixman_create,
+    .destroy = pixman_destroy,
+    .begin_frame = pixman_begin_frame,
+    .fill_rect = pixman_fill_rect,
+    .checker = pixman_checker,
+    .end_frame = pixman_end_frame,
+};
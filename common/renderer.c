@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "pattern-fill.h"
+#include "renderer.h"
+#include "tile-render.h"
+#include "trace.h"
+
+static struct renderer *cpu_create(const struct renderer_impl *impl) {
+    struct renderer *renderer = calloc(1, sizeof(*renderer));
+    if (!renderer) {
+        perror("calloc");
+        return NULL;
+    }
+    renderer->impl = impl;
+    return renderer;
+}
+
+static void cpu_destroy(struct renderer *renderer) {
+    free(renderer);
+}
+
+static void cpu_begin_frame(struct renderer *renderer) {
+    (void)renderer;
+}
+
+static int cpu_end_frame(struct renderer *renderer) {
+    (void)renderer;
+    return 0;
+}
+
+static const struct renderer_impl software_impl;
+static const struct renderer_impl scalar_impl;
+
+static struct renderer *software_create(void) {
+    return cpu_create(&software_impl);
+}
+
+static void software_fill_rect(struct renderer *renderer, int x, int y, int w,
+                               int h, uint32_t color) {
+    tile_fill_solid(renderer->pixels, renderer->stride, x, y, w, h, color);
+}
+
+static void software_checker(struct renderer *renderer, int x, int y, int w,
+                             int h, uint32_t first, uint32_t second) {
+    tile_fill_checker(renderer->pixels, renderer->stride, x, y, w, h, first,
+                      second);
+}
+
+static const struct renderer_impl software_impl = {
+    .name = "software",
+    .create = software_create,
+    .destroy = cpu_destroy,
+    .begin_frame = cpu_begin_frame,
+    .fill_rect = software_fill_rect,
+    .checker = software_checker,
+    .end_frame = cpu_end_frame,
+};
+
+static struct renderer *scalar_create(void) {
+    return cpu_create(&scalar_impl);
+}
+
+static void scalar_fill_rect(struct renderer *renderer, int x, int y, int w,
+                             int h, uint32_t color) {
+    for (int row = y; row < y + h; row++) {
+        uint32_t *line = renderer->pixels + (size_t)row * renderer->stride;
+        for (int col = x; col < x + w; col++) {
+            line[col] = color;
+        }
+    }
+}
+
+static void scalar_checker(struct renderer *renderer, int x, int y, int w,
+                           int h, uint32_t first, uint32_t second) {
+    for (int row = y; row < y + h; row++) {
+        uint32_t *line = renderer->pixels + (size_t)row * renderer->stride;
+        for (int col = x; col < x + w; col++) {
+            line[col] = ((col ^ row) & CHECKER_CELL) ? second : first;
+        }
+    }
+}
+
+static const struct renderer_impl scalar_impl = {
+    .name = "scalar",
+    .create = scalar_create,
+    .destroy = cpu_destroy,
+    .begin_frame = cpu_begin_frame,
+    .fill_rect = scalar_fill_rect,
+    .checker = scalar_checker,
+    .end_frame = cpu_end_frame,
+};
+
+#ifdef DEMOS_HAVE_PIXMAN
+extern const struct renderer_impl renderer_pixman_impl;
+#endif
+#ifdef DEMOS_HAVE_EGL
+extern const struct renderer_impl renderer_egl_impl;
+#endif
+
+static const struct renderer_impl *const impls[] = {
+    &software_impl,
+    &scalar_impl,
+#ifdef DEMOS_HAVE_PIXMAN
+    &renderer_pixman_impl,
+#endif
+#ifdef DEMOS_HAVE_EGL
+    &renderer_egl_impl,
+#endif
+};
+
+#define IMPL_COUNT (sizeof(impls) / sizeof(impls[0]))
+
+const char *const *renderer_names(void) {
+    static const char *names[IMPL_COUNT + 1];
+    for (size_t i = 0; i < IMPL_COUNT; i++) {
+        names[i] = impls[i]->name;
+    }
+    return names;
+}
+
+struct renderer *renderer_create(const char *name) {
+    int from_env = !name;
+    if (from_env) {
+        name = getenv("DEMOS_RENDERER");
+        if (!name || !*name) {
+            name = software_impl.name;
+        }
+    }
+
+    struct renderer *renderer = NULL;
+    size_t i;
+    for (i = 0; i < IMPL_COUNT; i++) {
+        if (!strcmp(impls[i]->name, name)) {
+            renderer = impls[i]->create();
+            break;
+        }
+    }
+    if (i == IMPL_COUNT) {
+        log_error("unknown renderer: %s", name);
+    }
+    if (!renderer && from_env && strcmp(name, software_impl.name)) {
+        log_warn("falling back to the software renderer");
+        renderer = software_impl.create();
+    }
+    return renderer;
+}
+
+void renderer_destroy(struct renderer *renderer) {
+    if (renderer) {
+        renderer->impl->destroy(renderer);
+    }
+}
+
+const char *renderer_name(const struct renderer *renderer) {
+    return renderer->impl->name;
+}
+
+// Whether the backend draws the current frame itself
+static int native(const struct renderer *renderer) {
+    return !renderer->pixels16 || renderer->impl->rgb565;
+}
+
+static void begin_frame(struct renderer *renderer, uint32_t *pixels,
+                        uint16_t *pixels16, int width, int height,
+                        int stride) {
+    renderer->pixels = pixels;
+    renderer->pixels16 = pixels16;
+    renderer->width = width;
+    renderer->height = height;
+    renderer->stride = stride;
+    renderer->drawn = 0;
+    renderer->opaque_width = 0;
+    renderer->opaque_height = 0;
+    if (native(renderer)) {
+        renderer->impl->begin_frame(renderer);
+    }
+}
+
+void renderer_begin_frame(struct renderer *renderer, uint32_t *pixels,
+                          int width, int height, int stride) {
+    begin_frame(renderer, pixels, NULL, width, height, stride);
+}
+
+void renderer_begin_frame_rgb565(struct renderer *renderer, uint16_t *pixels,
+                                 int width, int height, int stride) {
+    begin_frame(renderer, NULL, pixels, width, height, stride);
+}
+
+// Backends only ever see rects inside the buffer
+static int clip(const struct renderer *renderer, int *x, int *y, int *w,
+                int *h) {
+    int x1 = *x + *w, y1 = *y + *h;
+    if (*x < 0) {
+        *x = 0;
+    }
+    if (*y < 0) {
+        *y = 0;
+    }
+    if (x1 > renderer->width) {
+        x1 = renderer->width;
+    }
+    if (y1 > renderer->height) {
+        y1 = renderer->height;
+    }
+    *w = x1 - *x;
+    *h = y1 - *y;
+    return *w > 0 && *h > 0;
+}
+
+// Keeps one opaque rect rather than the exact region: the largest one
+// drawn, dropped altogether if anything translucent lands on it.
+static void track_opaque(struct renderer *renderer, int x, int y, int w, int h,
+                         int opaque) {
+    renderer->drawn = 1;
+    // RGB565 has no alpha
+    if (opaque || renderer->pixels16) {
+        if ((long)w * h >
+            (long)renderer->opaque_width * renderer->opaque_height) {
+            renderer->opaque_x = x;
+            renderer->opaque_y = y;
+            renderer->opaque_width = w;
+            renderer->opaque_height = h;
+        }
+    } else if (x < renderer->opaque_x + renderer->opaque_width &&
+               renderer->opaque_x < x + w &&
+               y < renderer->opaque_y + renderer->opaque_height &&
+               renderer->opaque_y < y + h) {
+        renderer->opaque_width = 0;
+        renderer->opaque_height = 0;
+    }
+}
+
+void renderer_fill_rect(struct renderer *renderer, int x, int y, int w, int h,
+                        uint32_t color) {
+    if (!clip(renderer, &x, &y, &w, &h)) {
+        return;
+    }
+    if (native(renderer)) {
+        renderer->impl->fill_rect(renderer, x, y, w, h, color);
+    } else {
+        tile_fill_solid16(renderer->pixels16, renderer->stride, x, y, w, h,
+                          color);
+    }
+    track_opaque(renderer, x, y, w, h, color >> 24 == 0xFF);
+}
+
+void renderer_checker(struct renderer *renderer, int x, int y, int w, int h,
+                      uint32_t first, uint32_t second) {
+    if (!clip(renderer, &x, &y, &w, &h)) {
+        return;
+    }
+    if (native(renderer)) {
+        renderer->impl->checker(renderer, x, y, w, h, first, second);
+    } else {
+        tile_fill_checker16(renderer->pixels16, renderer->stride, x, y, w, h,
+                            first, second);
+    }
+    track_opaque(renderer, x, y, w, h, (first & second) >> 24 == 0xFF);
+}
+
+int renderer_end_frame(struct renderer *renderer) {
+    TRACE_BEGIN("renderer_end_frame");
+    int ret = native(renderer) ? renderer->impl->end_frame(renderer) : 0;
+    TRACE_END("renderer_end_frame");
+    return ret;
+}
+
+int renderer_opaque_rect(const struct renderer *renderer, int *x, int *y,
+                         int *width, int *height) {
+    *x = renderer->opaque_x;
+    *y = renderer->opaque_y;
+    *width = renderer->opaque_width;
+    *height = renderer->opaque_height;
+    return renderer->drawn;
+}
@@ -0,0 +1,83 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <stdint.h>
+
+/*
+ * Draws into a 32bpp ARGB buffer the caller owns, usually an shm slot, or
+ * into a 16bpp RGB565 one started with renderer_begin_frame_rgb565().
+ * Between renderer_begin_frame() and renderer_end_frame() the drawing
+ * calls may be queued; only end_frame guarantees the pixels are in the
+ * buffer. Pixels no call touched keep their previous contents. stride is
+ * in pixels, coordinates are buffer coordinates, colours are always given
+ * as ARGB8888.
+ *
+ * Backends (renderer_names() lists those built in):
+ *   software  SIMD kernels split over the tile-render threads
+ *   scalar    plain per-pixel loops, the baseline
+ *   pixman    pixman fills and a repeating pattern image
+ *   egl       GLES on a surfaceless EGL display (e.g. Mesa llvmpipe),
+ *             read back into the buffer at end_frame
+ *
+ * RGB565 frames of backends without rgb565 set are drawn with the
+ * software backend's 16bpp kernels instead.
+ */
+struct renderer;
+
+struct renderer_impl {
+    const char *name;
+    /* draws RGB565 frames itself, from pixels16 */
+    int rgb565;
+    struct renderer *(*create)(void);
+    void (*destroy)(struct renderer *renderer);
+    void (*begin_frame)(struct renderer *renderer);
+    void (*fill_rect)(struct renderer *renderer, int x, int y, int w, int h,
+                      uint32_t color);
+    void (*checker)(struct renderer *renderer, int x, int y, int w, int h,
+                    uint32_t first, uint32_t second);
+    int (*end_frame)(struct renderer *renderer);
+};
+
+/* Backends embed this as their first member. */
+struct renderer {
+    const struct renderer_impl *impl;
+    uint32_t *pixels;
+    /* set instead of pixels for an RGB565 frame */
+    uint16_t *pixels16;
+    int width, height, stride;
+    /* what the current frame drew, see renderer_opaque_rect() */
+    int drawn;
+    int opaque_x, opaque_y, opaque_width, opaque_height;
+};
+
+/*
+ * NULL picks $DEMOS_RENDERER, falling back to software if that is unset
+ * or cannot be created. An explicit name that cannot be created returns
+ * NULL.
+ */
+struct renderer *renderer_create(const char *name);
+void renderer_destroy(struct renderer *renderer);
+const char *renderer_name(const struct renderer *renderer);
+const char *const *renderer_names(void);
+
+void renderer_begin_frame(struct renderer *renderer, uint32_t *pixels,
+                          int width, int height, int stride);
+void renderer_begin_frame_rgb565(struct renderer *renderer, uint16_t *pixels,
+                                 int width, int height, int stride);
+void renderer_fill_rect(struct renderer *renderer, int x, int y, int w, int h,
+                        uint32_t color);
+/* The chess board of pattern_fill_checker(), anchored at the buffer origin. */
+void renderer_checker(struct renderer *renderer, int x, int y, int w, int h,
+                      uint32_t first, uint32_t second);
+int renderer_end_frame(struct renderer *renderer);
+/*
+ * The largest rectangle the last frame painted with fully opaque colours
+ * and did not paint over translucently afterwards, in buffer coordinates.
+ * Returns 0 if the frame drew nothing, so the buffer kept whatever it
+ * held before. Otherwise returns 1, with a 0x0 rect if nothing drawn was
+ * opaque.
+ */
+int renderer_opaque_rect(const struct renderer *renderer, int *x, int *y,
+                         int *width, int *height);
+
+#endif
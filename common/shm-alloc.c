@@ -0,0 +1,195 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shm-alloc.h"
+#include "trace.h"
+
+static atomic_size_t mapped_bytes;
+static atomic_size_t high_water;
+
+static void account_map(size_t size) {
+    size_t mapped = atomic_fetch_add(&mapped_bytes, size) + size;
+    size_t peak = atomic_load(&high_water);
+    while (mapped > peak &&
+           !atomic_compare_exchange_weak(&high_water, &peak, mapped)) {
+    }
+    TRACE_COUNTER("shm_mapped_bytes", mapped);
+}
+
+static void account_unmap(size_t size) {
+    size_t mapped = atomic_fetch_sub(&mapped_bytes, size) - size;
+    TRACE_COUNTER("shm_mapped_bytes", mapped);
+}
+
+static void seal(int fd) {
+#ifdef F_SEAL_SHRINK
+    // The compositor maps this file too; forbidding shrinks means it can
+    // never take SIGBUS because of us. Growing stays allowed.
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_SEAL);
+#endif
+}
+
+static int create_memfd(size_t size) {
+#ifdef MFD_ALLOW_SEALING
+    int fd = memfd_create("wayland-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, size) < 0) {
+        perror("ftruncate");
+        close(fd);
+        return -1;
+    }
+    seal(fd);
+    return fd;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+static int create_hugetlb_memfd(size_t size) {
+#if defined(MFD_ALLOW_SEALING) && defined(MFD_HUGETLB)
+    int fd = memfd_create("wayland-shm",
+                          MFD_CLOEXEC | MFD_ALLOW_SEALING | MFD_HUGETLB);
+    if (fd < 0) {
+        return -1;
+    }
+    // Huge pages are only reserved at mmap time, so probe now while falling
+    // back to normal pages is still possible.
+    void *probe = MAP_FAILED;
+    if (ftruncate(fd, size) == 0) {
+        probe = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (probe == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+    munmap(probe, size);
+    seal(fd);
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+// Fallback for kernels without memfd_create. O_EXCL plus a retry keeps two
+// clients from ever opening the same object.
+static int create_shm_open(void) {
+    char name[] = "/wl_shm-XXXXXX";
+    for (int retries = 100; retries > 0; retries--) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        long r = ts.tv_nsec ^ getpid();
+        for (int i = 8; i < 14; i++) {
+            name[i] = 'A' + (r & 15) + (r & 16) * 2;
+            r >>= 5;
+        }
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0) {
+            shm_unlink(name);
+            return fd;
+        }
+        if (errno != EEXIST) {
+            break;
+        }
+    }
+    perror("shm_open");
+    return -1;
+}
+
+size_t shm_alloc_round(size_t size, int flags) {
+    if (flags & SHM_ALLOC_HUGETLB) {
+        size_t huge = SHM_ALLOC_HUGEPAGE_SIZE;
+        return (size + huge - 1) & ~(huge - 1);
+    }
+    return size;
+}
+
+int shm_alloc_file(size_t size, int flags) {
+    int fd = -1;
+    if (flags & SHM_ALLOC_HUGETLB) {
+        fd = create_hugetlb_memfd(shm_alloc_round(size, flags));
+    }
+    if (fd < 0) {
+        fd = create_memfd(size);
+    }
+    if (fd >= 0) {
+        return fd;
+    }
+
+    fd = create_shm_open();
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, size) < 0) {
+        perror("ftruncate");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void advise(void *data, size_t size) {
+#ifdef MADV_HUGEPAGE
+    if (size >= SHM_ALLOC_THP_THRESHOLD) {
+        madvise(data, size, MADV_HUGEPAGE);
+    }
+#endif
+}
+
+void *shm_alloc_map(int fd, size_t size) {
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    advise(data, size);
+    account_map(size);
+    return data;
+}
+
+void *shm_alloc_remap(int fd, void *data, size_t old_size, size_t new_size) {
+    if (ftruncate(fd, new_size) < 0) {
+        perror("ftruncate");
+        return NULL;
+    }
+    void *new_data = mremap(data, old_size, new_size, MREMAP_MAYMOVE);
+    if (new_data == MAP_FAILED) {
+        // hugetlb mappings cannot be moved by older kernels
+        new_data = shm_alloc_map(fd, new_size);
+        if (!new_data) {
+            return NULL;
+        }
+        shm_alloc_unmap(data, old_size);
+        return new_data;
+    }
+    advise(new_data, new_size);
+    account_unmap(old_size);
+    account_map(new_size);
+    return new_data;
+}
+
+void shm_alloc_unmap(void *data, size_t size) {
+    munmap(data, size);
+    account_unmap(size);
+}
+
+size_t shm_alloc_mapped_bytes(void) {
+    return atomic_load(&mapped_bytes);
+}
+
+size_t shm_alloc_high_water(void) {
+    return atomic_load(&high_water);
+}
+
+void shm_alloc_print_stats(FILE *out) {
+    fprintf(out, "shm mapped=%zuKiB high_water=%zuKiB\n",
+            shm_alloc_mapped_bytes() >> 10, shm_alloc_high_water() >> 10);
+}
@@ -0,0 +1,34 @@
+#ifndef SHM_ALLOC_H
+#define SHM_ALLOC_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Back the file with explicit hugetlb pages. Needs pages reserved in
+ * /proc/sys/vm/nr_hugepages; silently falls back to normal pages when
+ * none are available.
+ */
+#define SHM_ALLOC_HUGETLB (1 << 0)
+
+/* Mappings at least this large ask for transparent hugepages. */
+#define SHM_ALLOC_THP_THRESHOLD (8 << 20)
+
+#define SHM_ALLOC_HUGEPAGE_SIZE (2 << 20)
+
+size_t shm_alloc_round(size_t size, int flags);
+int shm_alloc_file(size_t size, int flags);
+void *shm_alloc_map(int fd, size_t size);
+void *shm_alloc_remap(int fd, void *data, size_t old_size, size_t new_size);
+void shm_alloc_unmap(void *data, size_t size);
+
+/*
+ * Bytes currently mapped through shm_alloc_map()/remap() and the most
+ * that were ever mapped at once, across all pools in the process. A
+ * mapped count that keeps climbing over a long session is a leak.
+ */
+size_t shm_alloc_mapped_bytes(void);
+size_t shm_alloc_high_water(void);
+void shm_alloc_print_stats(FILE *out);
+
+#endif
@@ -0,0 +1,69 @@
+#include <stdlib.h>
+
+#include "shm-format.h"
+
+// wl_shm.format events seen so far, for the formats picked from below
+static int have_rgb565;
+
+static void shm_format(void *data, struct wl_shm *shm, uint32_t format) {
+    (void)data;
+    (void)shm;
+    if (format == WL_SHM_FORMAT_RGB565) {
+        have_rgb565 = 1;
+    }
+}
+
+static const struct wl_shm_listener shm_listener = {
+    .format = shm_format,
+};
+
+void shm_format_listen(struct wl_shm *shm) {
+    wl_shm_add_listener(shm, &shm_listener, NULL);
+}
+
+int shm_format_supported(uint32_t format) {
+    switch (format) {
+    case WL_SHM_FORMAT_ARGB8888:
+    case WL_SHM_FORMAT_XRGB8888:
+        return 1;
+    case WL_SHM_FORMAT_RGB565:
+        return have_rgb565;
+    default:
+        return 0;
+    }
+}
+
+static int env_flag(const char *name) {
+    const char *env = getenv(name);
+    return !env || atoi(env) > 0;
+}
+
+int shm_format_use_opaque(void) {
+    static int use_opaque = -1;
+    if (use_opaque < 0) {
+        use_opaque = env_flag("DEMOS_OPAQUE");
+    }
+    return use_opaque;
+}
+
+static int use_rgb565(void) {
+    static int use = -1;
+    if (use < 0) {
+        use = env_flag("DEMOS_RGB565");
+    }
+    return use;
+}
+
+uint32_t shm_format_select(int opaque) {
+    if (!opaque || !shm_format_use_opaque()) {
+        return WL_SHM_FORMAT_ARGB8888;
+    }
+    if (use_rgb565() && shm_format_supported(WL_SHM_FORMAT_RGB565)) {
+        return WL_SHM_FORMAT_RGB565;
+    }
+    return WL_SHM_FORMAT_XRGB8888;
+}
+
+int shm_format_bpp(uint32_t format) {
+    return format == WL_SHM_FORMAT_RGB565 ? 2 : 4;
+}
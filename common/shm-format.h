@@ -0,0 +1,26 @@
+#ifndef SHM_FORMAT_H
+#define SHM_FORMAT_H
+
+#include <stdint.h>
+#include <wayland-client.h>
+
+/*
+ * Picks the wl_shm format of a buffer. wl_shm guarantees ARGB8888 and
+ * XRGB8888; content the caller knows to be fully opaque goes in XRGB8888
+ * so the compositor can skip blending it. Set $DEMOS_OPAQUE to 0 to keep
+ * everything in ARGB8888 without opaque regions, for comparison.
+ *
+ * Opaque content goes in RGB565 instead, halving the bytes written and
+ * read per frame, once the compositor has listed that format in a
+ * wl_shm.format event. shm_format_listen() has to be called right after
+ * binding wl_shm for those events to be seen; $DEMOS_RGB565=0 turns this
+ * off.
+ */
+void shm_format_listen(struct wl_shm *shm);
+int shm_format_supported(uint32_t format);
+uint32_t shm_format_select(int opaque);
+int shm_format_use_opaque(void);
+/* Bytes per pixel of the formats shm_format_select() returns. */
+int shm_format_bpp(uint32_t format);
+
+#endif
@@ -0,0 +1,326 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "shm-alloc.h"
+#include "shm-format.h"
+#include "shm-pool.h"
+#include "trace.h"
+
+static void buffer_release(void *data, struct wl_buffer *wl_buffer) {
+    (void)wl_buffer;
+    struct shm_slot *slot = data;
+    slot->busy = 0;
+    if (slot->stale) {
+        // The pool was re-laid out while the compositor still held this
+        // buffer, so its offset is no longer valid.
+        wl_buffer_destroy(slot->buffer);
+        slot->buffer = NULL;
+        slot->stale = 0;
+        slot->pool->buffer_count--;
+    }
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+    .release = buffer_release,
+};
+
+static void slot_drop_buffer(struct shm_slot *slot) {
+    if (!slot->buffer) {
+        return;
+    }
+    if (slot->busy) {
+        slot->stale = 1;
+        return;
+    }
+    wl_buffer_destroy(slot->buffer);
+    slot->buffer = NULL;
+    slot->pool->buffer_count--;
+}
+
+struct range {
+    size_t start, end;
+};
+
+static size_t page_round(size_t size) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    return (size + page - 1) & ~(page - 1);
+}
+
+static void pool_layout(struct shm_pool *pool, const size_t *offsets,
+                        size_t slot_size) {
+    pool->slot_size = slot_size;
+    for (int i = 0; i < pool->slot_count; i++) {
+        struct shm_slot *slot = &pool->slots[i];
+        slot_drop_buffer(slot);
+        slot->offset = offsets[i];
+        slot->data = (uint32_t *)(pool->data + slot->offset);
+    }
+}
+
+// Rows stay 4-byte aligned, which compositors expect of 16bpp buffers too
+static int stride_for(uint32_t format, int width) {
+    return (width * shm_format_bpp(format) + 3) & ~3;
+}
+
+// wl_shm takes strides and pool sizes as int32, and every slot of a pool
+// has to fit in one, so refuse anything bigger before the stride
+// arithmetic can overflow.
+static int size_valid(uint32_t format, int width, int height) {
+    if (width <= 0 || height <= 0 ||
+        width > (INT32_MAX - 3) / shm_format_bpp(format) ||
+        (size_t)stride_for(format, width) * height >
+            INT32_MAX / SHM_POOL_MAX_SLOTS) {
+        fprintf(stderr, "invalid shm buffer size: %dx%d\n", width, height);
+        return 0;
+    }
+    return 1;
+}
+
+static size_t slot_size_for(uint32_t format, int width, int height) {
+    return page_round((size_t)stride_for(format, width) * height);
+}
+
+// Lowest offset where size bytes overlap none of the taken ranges.
+static size_t first_fit(const struct range *taken, int count, size_t size) {
+    size_t offset = 0;
+    int moved = 1;
+    while (moved) {
+        moved = 0;
+        for (int i = 0; i < count; i++) {
+            if (offset < taken[i].end && taken[i].start < offset + size) {
+                offset = taken[i].end;
+                moved = 1;
+            }
+        }
+    }
+    return offset;
+}
+
+static int shm_pool_grow(struct shm_pool *pool, size_t slot_size) {
+    // Buffers still held by the compositor keep pointing at their old
+    // place, so new slots are fitted around them. Space of released
+    // buffers is reused instead of always going past the end of the pool.
+    struct range taken[2 * SHM_POOL_MAX_SLOTS];
+    int count = 0;
+    for (int i = 0; i < pool->slot_count; i++) {
+        struct shm_slot *slot = &pool->slots[i];
+        if (slot->busy && slot->buffer) {
+            taken[count].start = slot->buffer_offset;
+            taken[count].end = page_round(slot->buffer_offset +
+                                          (size_t)slot->stride * slot->height);
+            count++;
+        }
+    }
+    size_t offsets[SHM_POOL_MAX_SLOTS];
+    size_t end = 0;
+    for (int i = 0; i < pool->slot_count; i++) {
+        offsets[i] = first_fit(taken, count, slot_size);
+        taken[count].start = offsets[i];
+        taken[count].end = offsets[i] + slot_size;
+        if (taken[count].end > end) {
+            end = taken[count].end;
+        }
+        count++;
+    }
+
+    size_t size = shm_alloc_round(end, pool->alloc_flags);
+    if (size > INT32_MAX) {
+        fprintf(stderr, "shm pool too large: %zu bytes\n", size);
+        return -1;
+    }
+
+    uint8_t *data = pool->data;
+    if (pool->fd < 0) {
+        int fd = shm_alloc_file(size, pool->alloc_flags);
+        if (fd < 0) {
+            return -1;
+        }
+        data = shm_alloc_map(fd, size);
+        if (!data) {
+            close(fd);
+            return -1;
+        }
+        pool->fd = fd;
+        pool->pool = wl_shm_create_pool(pool->shm, fd, size);
+    } else if (size > pool->size) {
+        data = shm_alloc_remap(pool->fd, pool->data, pool->size, size);
+        if (!data) {
+            return -1;
+        }
+        wl_shm_pool_resize(pool->pool, size);
+    } else {
+        size = pool->size;
+    }
+
+    pool->data = data;
+    pool->size = size;
+    pool_layout(pool, offsets, slot_size);
+    return 0;
+}
+
+// Explicit hugetlb pages are opt-in, they need pages reserved beforehand
+static int use_hugetlb(void) {
+    const char *env = getenv("DEMOS_HUGETLB");
+    return env && atoi(env) > 0;
+}
+
+int shm_pool_init(struct shm_pool *pool, struct wl_shm *shm, int slot_count) {
+    if (slot_count < 1 || slot_count > SHM_POOL_MAX_SLOTS) {
+        fprintf(stderr, "invalid shm pool slot count: %d\n", slot_count);
+        return -1;
+    }
+    memset(pool, 0, sizeof(*pool));
+    pool->shm = shm;
+    pool->fd = -1;
+    if (use_hugetlb()) {
+        pool->alloc_flags = SHM_ALLOC_HUGETLB;
+    }
+    pool->format = WL_SHM_FORMAT_ARGB8888;
+    pool->slot_count = slot_count;
+    for (int i = 0; i < slot_count; i++) {
+        pool->slots[i].pool = pool;
+    }
+    return 0;
+}
+
+struct shm_slot *shm_pool_acquire(struct shm_pool *pool, int width, int height) {
+    if (!size_valid(pool->format, width, height)) {
+        return NULL;
+    }
+    int stride = stride_for(pool->format, width);
+    size_t needed = (size_t)stride * height;
+
+    if (needed > pool->slot_size) {
+        // Grow geometrically so an interactive resize only remaps a
+        // handful of times instead of on every configure.
+        size_t slot_size = pool->slot_size + pool->slot_size / 2;
+        if (slot_size < needed || slot_size > INT32_MAX / SHM_POOL_MAX_SLOTS) {
+            slot_size = needed;
+        }
+        slot_size = page_round(slot_size);
+        TRACE_BEGIN("shm_pool_grow");
+        int ret = shm_pool_grow(pool, slot_size);
+        TRACE_END("shm_pool_grow");
+        if (ret < 0) {
+            return NULL;
+        }
+    }
+
+    struct shm_slot *idle = NULL;
+    struct shm_slot *match = NULL;
+    for (int i = 0; i < pool->slot_count; i++) {
+        struct shm_slot *slot = &pool->slots[i];
+        if (slot->busy) {
+            continue;
+        }
+        if (slot->buffer && slot->width == width && slot->height == height &&
+            slot->format == pool->format) {
+            match = slot;
+            break;
+        }
+        if (!idle) {
+            idle = slot;
+        }
+    }
+
+    struct shm_slot *slot = match ? match : idle;
+    if (!slot) {
+        return NULL;
+    }
+
+    if (!match) {
+        TRACE_INSTANT("shm_pool_create_buffer");
+        slot_drop_buffer(slot);
+        slot->buffer = wl_shm_pool_create_buffer(pool->pool, slot->offset,
+                                                 width, height, stride,
+                                                 pool->format);
+        wl_buffer_add_listener(slot->buffer, &buffer_listener, slot);
+        pool->buffer_count++;
+        slot->buffer_offset = slot->offset;
+        slot->width = width;
+        slot->height = height;
+        slot->stride = stride;
+        slot->format = pool->format;
+    }
+    slot->fresh = !match;
+    slot->busy = 1;
+    return slot;
+}
+
+int shm_pool_trim(struct shm_pool *pool, int width, int height) {
+    if (!size_valid(pool->format, width, height)) {
+        return -1;
+    }
+    size_t slot_size = slot_size_for(pool->format, width, height);
+    size_t size = shm_alloc_round(slot_size * pool->slot_count,
+                                  pool->alloc_flags);
+    if (pool->fd < 0 || size * 2 > pool->size) {
+        return 0;
+    }
+
+    int fd = shm_alloc_file(size, pool->alloc_flags);
+    if (fd < 0) {
+        return -1;
+    }
+    uint8_t *data = shm_alloc_map(fd, size);
+    if (!data) {
+        close(fd);
+        return -1;
+    }
+
+    // A wl_shm_pool only ever grows, so move to a fresh one. Buffers the
+    // compositor still holds keep the old pool's memory alive on its side
+    // and are destroyed on release like after any other re-layout.
+    TRACE_BEGIN("shm_pool_trim");
+    wl_shm_pool_destroy(pool->pool);
+    shm_alloc_unmap(pool->data, pool->size);
+    close(pool->fd);
+    pool->fd = fd;
+    pool->pool = wl_shm_create_pool(pool->shm, fd, size);
+    pool->data = data;
+    pool->size = size;
+    size_t offsets[SHM_POOL_MAX_SLOTS];
+    for (int i = 0; i < pool->slot_count; i++) {
+        offsets[i] = slot_size * i;
+    }
+    pool_layout(pool, offsets, slot_size);
+    TRACE_END("shm_pool_trim");
+    return 1;
+}
+
+void shm_pool_finish(struct shm_pool *pool) {
+    for (int i = 0; i < pool->slot_count; i++) {
+        struct shm_slot *slot = &pool->slots[i];
+        if (slot->buffer) {
+            wl_buffer_destroy(slot->buffer);
+            slot->buffer = NULL;
+        }
+    }
+    pool->buffer_count = 0;
+    if (pool->pool) {
+        wl_shm_pool_destroy(pool->pool);
+        pool->pool = NULL;
+    }
+    if (pool->data) {
+        shm_alloc_unmap(pool->data, pool->size);
+        pool->data = NULL;
+    }
+    if (pool->fd >= 0) {
+        close(pool->fd);
+        pool->fd = -1;
+    }
+}
+
+void shm_slot_begin_frame(struct shm_slot *slot, struct renderer *renderer) {
+    if (slot->format == WL_SHM_FORMAT_RGB565) {
+        renderer_begin_frame_rgb565(renderer, (uint16_t *)slot->data,
+                                    slot->width, slot->height,
+                                    slot->stride / 2);
+    } else {
+        renderer_begin_frame(renderer, slot->data, slot->width, slot->height,
+                             slot->stride / 4);
+    }
+}
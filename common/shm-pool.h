@@ -0,0 +1,78 @@
+#ifndef SHM_POOL_H
+#define SHM_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <wayland-client.h>
+
+#include "renderer.h"
+
+#define SHM_POOL_MAX_SLOTS 4
+
+struct shm_pool;
+
+/*
+ * One buffer carved out of the shared pool. A slot is handed out by
+ * shm_pool_acquire() and stays busy until the compositor sends
+ * wl_buffer.release for it. fresh is set when the slot got a new
+ * wl_buffer, meaning its previous contents are gone.
+ */
+struct shm_slot {
+    struct shm_pool *pool;
+    struct wl_buffer *buffer;
+    uint32_t *data;
+    size_t offset;
+    /* where buffer starts, offset may have moved on while it was busy */
+    size_t buffer_offset;
+    int width, height, stride;
+    uint32_t format;
+    int busy;
+    int stale;
+    int fresh;
+};
+
+/*
+ * A single wl_shm_pool backed by one fd and one mapping, split into
+ * slot_count equally sized slots. The mapping only ever grows (using
+ * wl_shm_pool_resize), so once the surface stops growing no further
+ * syscalls are made: acquiring an idle slot of the same size reuses its
+ * wl_buffer as is. When slots grow while the compositor holds some of
+ * them, the new slots are fitted around the held buffers, reusing the
+ * space of released ones. Sizes whose buffers wl_shm could not describe
+ * (int32 strides and pool sizes) are refused. alloc_flags (SHM_ALLOC_*)
+ * may be set between shm_pool_init() and the first acquire; init sets
+ * SHM_ALLOC_HUGETLB when $DEMOS_HUGETLB is 1. format (a wl_shm format,
+ * ARGB8888 by default, see shm-format.h) may change at any time and
+ * applies to the buffers acquired after it; a slot whose buffer has
+ * another format comes back fresh. buffer_count is the number of live
+ * wl_buffers, including ones only kept until the compositor releases them.
+ */
+struct shm_pool {
+    struct wl_shm *shm;
+    struct wl_shm_pool *pool;
+    int fd;
+    int alloc_flags;
+    uint32_t format;
+    uint8_t *data;
+    size_t size;
+    size_t slot_size;
+    int slot_count;
+    int buffer_count;
+    struct shm_slot slots[SHM_POOL_MAX_SLOTS];
+};
+
+int shm_pool_init(struct shm_pool *pool, struct wl_shm *shm, int slot_count);
+struct shm_slot *shm_pool_acquire(struct shm_pool *pool, int width, int height);
+/*
+ * Move to a new, smaller wl_shm_pool sized for width x height slots if the
+ * current one is more than twice that, e.g. once an interactive resize
+ * has settled. Every slot comes back fresh. Returns 1 if the pool was
+ * replaced, 0 if it was left alone and -1 on error.
+ */
+int shm_pool_trim(struct shm_pool *pool, int width, int height);
+void shm_pool_finish(struct shm_pool *pool);
+
+/* Start a renderer frame over the whole slot, in the slot's format. */
+void shm_slot_begin_frame(struct shm_slot *slot, struct renderer *renderer);
+
+#endif
@@ -0,0 +1,221 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shm-alloc.h"
+#include "size-channel.h"
+
+struct size_record *size_record_create(int *fd_out) {
+    int fd = shm_alloc_file(sizeof(struct size_record), 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct size_record *record = shm_alloc_map(fd, sizeof(*record));
+    if (!record) {
+        close(fd);
+        return NULL;
+    }
+    *fd_out = fd;
+    return record;
+}
+
+struct size_record *size_record_map(int fd) {
+    struct size_record *record =
+        mmap(NULL, sizeof(*record), PROT_READ, MAP_SHARED, fd, 0);
+    if (record == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    return record;
+}
+
+void size_record_unmap(struct size_record *record) {
+    munmap(record, sizeof(*record));
+}
+
+// Single writer: only the controller ever publishes.
+void size_record_publish(struct size_record *record, int width, int height) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t time_ns = ts.tv_sec * 1000000000ull + ts.tv_nsec;
+
+    uint32_t seq = atomic_load_explicit(&record->seq, memory_order_relaxed);
+    atomic_store_explicit(&record->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    uint32_t serial =
+        atomic_load_explicit(&record->serial, memory_order_relaxed);
+    atomic_store_explicit(&record->serial, serial + 1, memory_order_relaxed);
+    atomic_store_explicit(&record->width, width, memory_order_relaxed);
+    atomic_store_explicit(&record->height, height, memory_order_relaxed);
+    atomic_store_explicit(&record->time_ns, time_ns, memory_order_relaxed);
+
+    atomic_store_explicit(&record->seq, seq + 2, memory_order_release);
+}
+
+// Returns the serial of the size read; it changes on every publish.
+uint32_t size_record_read(struct size_record *record, int *width,
+                          int *height, uint64_t *time_ns) {
+    uint32_t seq, serial;
+    do {
+        seq = atomic_load_explicit(&record->seq, memory_order_acquire);
+        serial = atomic_load_explicit(&record->serial, memory_order_relaxed);
+        *width = atomic_load_explicit(&record->width, memory_order_relaxed);
+        *height = atomic_load_explicit(&record->height, memory_order_relaxed);
+        *time_ns =
+            atomic_load_explicit(&record->time_ns, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+    } while ((seq & 1) ||
+             seq != atomic_load_explicit(&record->seq, memory_order_relaxed));
+    return serial;
+}
+
+static int socket_address(struct sockaddr_un *addr) {
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    if (!dir) {
+        dir = "/tmp";
+    }
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    int len = snprintf(addr->sun_path, sizeof(addr->sun_path), "%s/%s", dir,
+                       SIZE_CHANNEL_NAME);
+    if (len < 0 || (size_t)len >= sizeof(addr->sun_path)) {
+        fprintf(stderr, "size channel path too long\n");
+        return -1;
+    }
+    return 0;
+}
+
+int size_channel_listen(void) {
+    struct sockaddr_un addr;
+    if (socket_address(&addr) < 0) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    // a previous controller may have left its socket behind
+    unlink(addr.sun_path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+    if (listen(fd, 16) < 0) {
+        perror("listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int size_channel_accept(int listen_fd) {
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0 && errno != EAGAIN) {
+        perror("accept");
+    }
+    return fd;
+}
+
+int size_channel_connect(void) {
+    struct sockaddr_un addr;
+    if (socket_address(&addr) < 0) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("connect");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int size_channel_send_record(int fd, int record_fd) {
+    char byte = 0;
+    struct iovec iov = {.iov_base = &byte, .iov_len = 1};
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &record_fd, sizeof(int));
+
+    if (sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+        perror("sendmsg");
+        return -1;
+    }
+    return 0;
+}
+
+// Returns -1 once the peer is gone. If the follower still has an unread
+// wakeup queued the socket may be full, which is fine: it will read the
+// newest size from the record anyway.
+int size_channel_notify(int fd) {
+    char byte = 1;
+    if (send(fd, &byte, 1, MSG_DONTWAIT | MSG_NOSIGNAL) < 0 &&
+        errno != EAGAIN) {
+        return -1;
+    }
+    return 0;
+}
+
+// Drains every queued wakeup. Returns 1 if the record may have changed, 0
+// if there was nothing to read and -1 once the peer is gone. *record_fd
+// is set when the controller handed over the record.
+int size_channel_recv(int fd, int *record_fd) {
+    int got = 0;
+    for (;;) {
+        char buf[64];
+        union {
+            char buf[CMSG_SPACE(sizeof(int))];
+            struct cmsghdr align;
+        } control;
+        struct iovec iov = {.iov_base = buf, .iov_len = sizeof(buf)};
+        struct msghdr msg = {
+            .msg_iov = &iov,
+            .msg_iovlen = 1,
+            .msg_control = control.buf,
+            .msg_controllen = sizeof(control.buf),
+        };
+        ssize_t n = recvmsg(fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+        if (n > 0) {
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            if (cmsg && cmsg->cmsg_level == SOL_SOCKET &&
+                cmsg->cmsg_type == SCM_RIGHTS) {
+                memcpy(record_fd, CMSG_DATA(cmsg), sizeof(int));
+            }
+            got = 1;
+        } else if (n == 0) {
+            return -1;
+        } else if (errno == EAGAIN) {
+            return got;
+        } else if (errno != EINTR) {
+            return -1;
+        }
+    }
+}
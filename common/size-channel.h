@@ -0,0 +1,44 @@
+#ifndef SIZE_CHANNEL_H
+#define SIZE_CHANNEL_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*
+ * Window size sync between one controller and any number of followers.
+ *
+ * The size itself lives in a size_record: a seqlock in a memfd that the
+ * controller writes and every follower maps read-only. Followers never
+ * block the controller and read the newest size with two loads of seq
+ * around the payload, however many updates they missed. time_ns is the
+ * CLOCK_MONOTONIC time of the publish, for measuring propagation latency.
+ *
+ * A SOCK_SEQPACKET Unix socket in $XDG_RUNTIME_DIR carries the rest: the
+ * first message hands the record fd to a new follower, every later one is
+ * a one byte "seq changed" wakeup that followers can poll on.
+ */
+#define SIZE_CHANNEL_NAME "wayland-demos-size"
+
+struct size_record {
+    _Atomic uint32_t seq;
+    _Atomic uint32_t serial;
+    _Atomic int32_t width;
+    _Atomic int32_t height;
+    _Atomic uint64_t time_ns;
+};
+
+struct size_record *size_record_create(int *fd_out);
+struct size_record *size_record_map(int fd);
+void size_record_publish(struct size_record *record, int width, int height);
+uint32_t size_record_read(struct size_record *record, int *width,
+                          int *height, uint64_t *time_ns);
+void size_record_unmap(struct size_record *record);
+
+int size_channel_listen(void);
+int size_channel_accept(int listen_fd);
+int size_channel_connect(void);
+int size_channel_send_record(int fd, int record_fd);
+int size_channel_notify(int fd);
+int size_channel_recv(int fd, int *record_fd);
+
+#endif
@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "shm-format.h"
+#include "solid-surface.h"
+#include "trace.h"
+
+int solid_surface_use_viewport(void) {
+    const char *env = getenv("DEMOS_VIEWPORT");
+    return env && atoi(env) > 0;
+}
+
+#ifdef DEMOS_HAVE_SINGLE_PIXEL_BUFFER
+static int use_single_pixel(void) {
+    const char *env = getenv("DEMOS_SINGLE_PIXEL");
+    return !env || atoi(env) > 0;
+}
+
+// Buffers of earlier colours go once the compositor is done with them;
+// the current one is kept until it is replaced.
+static void single_pixel_release(void *data, struct wl_buffer *buffer) {
+    struct solid_surface *solid = data;
+    if (buffer == solid->buffer) {
+        solid->buffer_released = 1;
+    } else {
+        wl_buffer_destroy(buffer);
+    }
+}
+
+static const struct wl_buffer_listener single_pixel_listener = {
+    .release = single_pixel_release,
+};
+
+static struct wl_buffer *single_pixel_buffer(struct solid_surface *solid,
+                                             uint32_t color) {
+    // ARGB8888 is premultiplied too, each channel just widens to 32 bits
+    struct wl_buffer *buffer =
+        wp_single_pixel_buffer_manager_v1_create_u32_rgba_buffer(
+            solid->single_pixel, ((color >> 16) & 0xFF) * 0x01010101u,
+            ((color >> 8) & 0xFF) * 0x01010101u, (color & 0xFF) * 0x01010101u,
+            (color >> 24) * 0x01010101u);
+    wl_buffer_add_listener(buffer, &single_pixel_listener, solid);
+    if (solid->buffer && solid->buffer_released) {
+        wl_buffer_destroy(solid->buffer);
+    }
+    solid->buffer_released = 0;
+    return buffer;
+}
+#endif
+
+void solid_surface_init(struct solid_surface *solid,
+                        struct wl_compositor *compositor,
+                        struct wl_surface *surface,
+                        struct shm_pool *pool, struct renderer *renderer,
+                        struct wp_viewporter *viewporter,
+                        struct wp_single_pixel_buffer_manager_v1 *single_pixel) {
+    memset(solid, 0, sizeof(*solid));
+    solid->surface = surface;
+    solid->pool = pool;
+    solid->renderer = renderer;
+    opaque_region_init(&solid->opaque, compositor, surface);
+    if (!viewporter) {
+        return;
+    }
+#ifdef DEMOS_HAVE_SINGLE_PIXEL_BUFFER
+    if (single_pixel && use_single_pixel()) {
+        solid->single_pixel = single_pixel;
+    }
+#endif
+    if (solid->single_pixel || solid_surface_use_viewport()) {
+        solid->viewport = wp_viewporter_get_viewport(viewporter, surface);
+    }
+}
+
+static struct wl_buffer *fill_buffer(struct solid_surface *solid, int width,
+                                     int height, uint32_t color) {
+    solid->pool->format = shm_format_select(color >> 24 == 0xFF);
+    struct shm_slot *slot = shm_pool_acquire(solid->pool, width, height);
+    if (!slot) {
+        return NULL;
+    }
+    shm_slot_begin_frame(slot, solid->renderer);
+    renderer_fill_rect(solid->renderer, 0, 0, width, height, color);
+    renderer_end_frame(solid->renderer);
+    return slot->buffer;
+}
+
+int solid_surface_update(struct solid_surface *solid, int width, int height,
+                         uint32_t color) {
+    TRACE_BEGIN("solid_surface_update");
+    if (!solid->viewport) {
+        struct wl_buffer *buffer = fill_buffer(solid, width, height, color);
+        if (!buffer) {
+            TRACE_END("solid_surface_update");
+            return -1;
+        }
+        wl_surface_attach(solid->surface, buffer, 0, 0);
+        wl_surface_damage_buffer(solid->surface, 0, 0, width, height);
+    } else {
+        // The small buffer only changes with the colour; a new size is
+        // just a new destination rectangle.
+        if (!solid->buffer || color != solid->color) {
+            struct wl_buffer *buffer;
+#ifdef DEMOS_HAVE_SINGLE_PIXEL_BUFFER
+            if (solid->single_pixel) {
+                buffer = single_pixel_buffer(solid, color);
+            } else
+#endif
+            {
+                buffer = fill_buffer(solid, SOLID_SURFACE_SOURCE_SIZE,
+                                     SOLID_SURFACE_SOURCE_SIZE, color);
+            }
+            if (!buffer) {
+                TRACE_END("solid_surface_update");
+                return -1;
+            }
+            wl_surface_attach(solid->surface, buffer, 0, 0);
+            wl_surface_damage_buffer(solid->surface, 0, 0, INT32_MAX,
+                                     INT32_MAX);
+            solid->buffer = buffer;
+        }
+        if (width != solid->width || height != solid->height) {
+            wp_viewport_set_destination(solid->viewport, width, height);
+        }
+    }
+    // the whole surface is one colour, no need to ask the renderer
+    if (color >> 24 == 0xFF) {
+        opaque_region_set(&solid->opaque, 0, 0, width, height);
+    } else {
+        opaque_region_set(&solid->opaque, 0, 0, 0, 0);
+    }
+    solid->color = color;
+    solid->width = width;
+    solid->height = height;
+    TRACE_END("solid_surface_update");
+    return 0;
+}
+
+void solid_surface_finish(struct solid_surface *solid) {
+    if (solid->single_pixel && solid->buffer) {
+        wl_buffer_destroy(solid->buffer);
+    }
+    if (solid->viewport) {
+        wp_viewport_destroy(solid->viewport);
+    }
+    memset(solid, 0, sizeof(*solid));
+}
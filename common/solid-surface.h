@@ -0,0 +1,63 @@
+#ifndef SOLID_SURFACE_H
+#define SOLID_SURFACE_H
+
+#include <stdint.h>
+#include <wayland-client.h>
+
+#include "opaque-region.h"
+#include "renderer.h"
+#include "shm-pool.h"
+#include "viewporter-client-protocol.h"
+#ifdef DEMOS_HAVE_SINGLE_PIXEL_BUFFER
+#include "single-pixel-buffer-v1-client-protocol.h"
+#endif
+
+struct wp_single_pixel_buffer_manager_v1;
+
+/* Side of the buffer a viewport stretches over the whole surface. */
+#define SOLID_SURFACE_SOURCE_SIZE 4
+
+/*
+ * Keeps a surface showing a single colour at a given size. Without a
+ * viewport every size change acquires and fills a full-size shm buffer.
+ * With one, a tiny buffer is made once per colour and stretched with
+ * wp_viewport.set_destination, so a resize only costs that request. The
+ * tiny buffer is a wp_single_pixel_buffer_manager_v1 buffer when the
+ * compositor has one, which needs no memory or filling on our side, and a
+ * SOLID_SURFACE_SOURCE_SIZE square shm buffer otherwise. Opaque colours
+ * get XRGB8888 buffers and an opaque region covering the surface.
+ * solid_surface_update() attaches and damages as needed; the caller
+ * commits.
+ */
+struct solid_surface {
+    struct wl_surface *surface;
+    struct wp_viewport *viewport;
+    struct wp_single_pixel_buffer_manager_v1 *single_pixel;
+    struct shm_pool *pool;
+    struct renderer *renderer;
+    struct opaque_region opaque;
+    struct wl_buffer *buffer;
+    int buffer_released;
+    uint32_t color;
+    int width, height;
+};
+
+/*
+ * viewporter and single_pixel may be NULL. Single-pixel buffers are used
+ * whenever both are there (unless $DEMOS_SINGLE_PIXEL is 0); a viewport
+ * alone is only used if solid_surface_use_viewport() says so.
+ */
+void solid_surface_init(struct solid_surface *solid,
+                        struct wl_compositor *compositor,
+                        struct wl_surface *surface,
+                        struct shm_pool *pool, struct renderer *renderer,
+                        struct wp_viewporter *viewporter,
+                        struct wp_single_pixel_buffer_manager_v1 *single_pixel);
+int solid_surface_update(struct solid_surface *solid, int width, int height,
+                         uint32_t color);
+void solid_surface_finish(struct solid_surface *solid);
+
+/* Viewport scaling is opt-in: set $DEMOS_VIEWPORT to 1. */
+int solid_surface_use_viewport(void);
+
+#endif
@@ -0,0 +1,277 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pattern-fill.h"
+#include "tile-render.h"
+#include "trace.h"
+
+/*
+ * Each thread owns a run of tile indices packed into one word, begin in
+ * the low half and end in the high half. The owner takes tiles from the
+ * front and thieves cut off the back, both with a CAS on the whole word,
+ * so a tile is handed out exactly once without any lock.
+ */
+struct run {
+    _Alignas(64) atomic_uint_fast64_t range;
+};
+
+static struct run runs[TILE_RENDER_MAX_THREADS];
+static pthread_t threads[TILE_RENDER_MAX_THREADS];
+static int thread_count = 1;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t idle = PTHREAD_COND_INITIALIZER;
+static unsigned generation;
+static int finished_workers;
+static int quit;
+
+// The current render, only written while every worker is idle
+static struct {
+    void *pixels;
+    int stride;
+    int x, y, w, h;
+    int tiles_x;
+    tile_func func;
+    void *data;
+} job;
+
+static uint64_t pack(uint32_t begin, uint32_t end) {
+    return (uint64_t)end << 32 | begin;
+}
+
+static int take_own(struct run *run) {
+    uint64_t range = atomic_load(&run->range);
+    for (;;) {
+        uint32_t begin = range, end = range >> 32;
+        if (begin >= end) {
+            return -1;
+        }
+        if (atomic_compare_exchange_weak(&run->range, &range,
+                                         pack(begin + 1, end))) {
+            return begin;
+        }
+    }
+}
+
+// Cut the back half off another thread's run, keep its first tile and
+// make the rest our own run.
+static int steal(int self) {
+    for (int i = 1; i < thread_count; i++) {
+        struct run *victim = &runs[(self + i) % thread_count];
+        uint64_t range = atomic_load(&victim->range);
+        for (;;) {
+            uint32_t begin = range, end = range >> 32;
+            if (begin >= end) {
+                break;
+            }
+            uint32_t mid = begin + (end - begin) / 2;
+            if (atomic_compare_exchange_weak(&victim->range, &range,
+                                             pack(begin, mid))) {
+                atomic_store(&runs[self].range, pack(mid + 1, end));
+                return mid;
+            }
+        }
+    }
+    return -1;
+}
+
+static void run_tile(int tile) {
+    int tx = tile % job.tiles_x;
+    int ty = tile / job.tiles_x;
+    int x = job.x + tx * TILE_SIZE;
+    int y = job.y + ty * TILE_SIZE;
+    int w = job.x + job.w - x;
+    int h = job.y + job.h - y;
+    job.func(job.data, job.pixels, job.stride, x, y,
+             w < TILE_SIZE ? w : TILE_SIZE, h < TILE_SIZE ? h : TILE_SIZE);
+}
+
+static void participate(int self) {
+    int tile;
+    while ((tile = take_own(&runs[self])) >= 0 || (tile = steal(self)) >= 0) {
+        run_tile(tile);
+    }
+}
+
+static void *worker_thread(void *data) {
+    int self = (int)(intptr_t)data;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        while (generation == seen && !quit) {
+            pthread_cond_wait(&work, &lock);
+        }
+        if (quit) {
+            break;
+        }
+        seen = generation;
+        pthread_mutex_unlock(&lock);
+
+        TRACE_BEGIN("tile_worker");
+        participate(self);
+        TRACE_END("tile_worker");
+
+        pthread_mutex_lock(&lock);
+        if (++finished_workers == thread_count - 1) {
+            pthread_cond_signal(&idle);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+int tile_render_init(int count) {
+    if (count <= 0) {
+        const char *env = getenv("DEMOS_RENDER_THREADS");
+        count = env ? atoi(env) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (count < 1) {
+        count = 1;
+    }
+    if (count > TILE_RENDER_MAX_THREADS) {
+        count = TILE_RENDER_MAX_THREADS;
+    }
+
+    // Pick the fill kernel now rather than racing to do it from the workers
+    pattern_fill_isa_name();
+
+    quit = 0;
+    generation = 0;
+    // Render threads must not take signals meant for the event loop
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    for (thread_count = 1; thread_count < count; thread_count++) {
+        int ret = pthread_create(&threads[thread_count], NULL, worker_thread,
+                                 (void *)(intptr_t)thread_count);
+        if (ret != 0) {
+            fprintf(stderr, "pthread_create: %s\n", strerror(ret));
+            break;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return thread_count == count ? 0 : -1;
+}
+
+void tile_render_finish(void) {
+    pthread_mutex_lock(&lock);
+    quit = 1;
+    pthread_cond_broadcast(&work);
+    pthread_mutex_unlock(&lock);
+    for (int i = 1; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    thread_count = 1;
+}
+
+int tile_render_thread_count(void) {
+    return thread_count;
+}
+
+void tile_render(void *pixels, int stride, int x, int y, int w, int h,
+                 tile_func func, void *data) {
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+    if (thread_count == 1 || (long)w * h < TILE_RENDER_MIN_PIXELS) {
+        func(data, pixels, stride, x, y, w, h);
+        return;
+    }
+
+    TRACE_BEGIN("tile_render");
+    job.pixels = pixels;
+    job.stride = stride;
+    job.x = x;
+    job.y = y;
+    job.w = w;
+    job.h = h;
+    job.tiles_x = (w + TILE_SIZE - 1) / TILE_SIZE;
+    job.func = func;
+    job.data = data;
+
+    // Contiguous runs keep each thread on neighbouring rows of tiles
+    int tiles = job.tiles_x * ((h + TILE_SIZE - 1) / TILE_SIZE);
+    for (int i = 0; i < thread_count; i++) {
+        atomic_store(&runs[i].range,
+                     pack((long)tiles * i / thread_count,
+                          (long)tiles * (i + 1) / thread_count));
+    }
+
+    pthread_mutex_lock(&lock);
+    finished_workers = 0;
+    generation++;
+    pthread_cond_broadcast(&work);
+    pthread_mutex_unlock(&lock);
+
+    participate(0);
+
+    // Workers may still be finishing a stolen tile
+    pthread_mutex_lock(&lock);
+    while (finished_workers < thread_count - 1) {
+        pthread_cond_wait(&idle, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+    TRACE_END("tile_render");
+}
+
+struct fill {
+    uint32_t first, second;
+};
+
+static void fill_solid(void *data, void *pixels, int stride, int x, int y,
+                       int w, int h) {
+    struct fill *fill = data;
+    pattern_fill_solid(pixels, stride, x, y, w, h, fill->first);
+}
+
+static void fill_checker(void *data, void *pixels, int stride, int x, int y,
+                         int w, int h) {
+    struct fill *fill = data;
+    pattern_fill_checker(pixels, stride, x, y, w, h, fill->first,
+                         fill->second);
+}
+
+static void fill_solid16(void *data, void *pixels, int stride, int x, int y,
+                         int w, int h) {
+    struct fill *fill = data;
+    pattern_fill_solid16(pixels, stride, x, y, w, h, fill->first);
+}
+
+static void fill_checker16(void *data, void *pixels, int stride, int x, int y,
+                           int w, int h) {
+    struct fill *fill = data;
+    pattern_fill_checker16(pixels, stride, x, y, w, h, fill->first,
+                           fill->second);
+}
+
+void tile_fill_solid(uint32_t *pixels, int stride, int x, int y, int w,
+                     int h, uint32_t color) {
+    struct fill fill = {color, color};
+    tile_render(pixels, stride, x, y, w, h, fill_solid, &fill);
+}
+
+void tile_fill_checker(uint32_t *pixels, int stride, int x, int y, int w,
+                       int h, uint32_t first, uint32_t second) {
+    struct fill fill = {first, second};
+    tile_render(pixels, stride, x, y, w, h, fill_checker, &fill);
+}
+
+void tile_fill_solid16(uint16_t *pixels, int stride, int x, int y, int w,
+                       int h, uint32_t color) {
+    struct fill fill = {color, color};
+    tile_render(pixels, stride, x, y, w, h, fill_solid16, &fill);
+}
+
+void tile_fill_checker16(uint16_t *pixels, int stride, int x, int y, int w,
+                         int h, uint32_t first, uint32_t second) {
+    struct fill fill = {first, second};
+    tile_render(pixels, stride, x, y, w, h, fill_checker16, &fill);
+}
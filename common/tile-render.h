@@ -0,0 +1,52 @@
+#ifndef TILE_RENDER_H
+#define TILE_RENDER_H
+
+#include <stdint.h>
+
+/* Side of one tile, in pixels. */
+#define TILE_SIZE 64
+
+#define TILE_RENDER_MAX_THREADS 32
+
+/* Smaller renders are not worth waking the workers for. */
+#define TILE_RENDER_MIN_PIXELS (512 * 512)
+
+/*
+ * Renders (x, y, w, h) of a buffer. Called once per tile, possibly from
+ * several threads at once, always with disjoint rectangles. The pool
+ * never looks at the pixels, so their format is up to func; stride is in
+ * pixels.
+ */
+typedef void (*tile_func)(void *data, void *pixels, int stride, int x, int y,
+                          int w, int h);
+
+/*
+ * Persistent pool of render threads shared by the whole process. A render
+ * is split into TILE_SIZE tiles, handed out to the workers and the
+ * calling thread in contiguous runs, and a thread that runs out of tiles
+ * steals the back half of another thread's run. tile_render() returns
+ * once every tile is done.
+ *
+ * threads counts the calling thread; 0 picks $DEMOS_RENDER_THREADS or the
+ * number of online CPUs. Without tile_render_init() (or with one thread)
+ * everything runs on the calling thread. Only one thread may call
+ * tile_render() at a time.
+ */
+int tile_render_init(int threads);
+void tile_render_finish(void);
+int tile_render_thread_count(void);
+
+void tile_render(void *pixels, int stride, int x, int y, int w, int h,
+                 tile_func func, void *data);
+
+/* Tiled versions of the pattern_fill_*() functions. */
+void tile_fill_solid(uint32_t *pixels, int stride, int x, int y, int w,
+                     int h, uint32_t color);
+void tile_fill_checker(uint32_t *pixels, int stride, int x, int y, int w,
+                       int h, uint32_t first, uint32_t second);
+void tile_fill_solid16(uint16_t *pixels, int stride, int x, int y, int w,
+                       int h, uint32_t color);
+void tile_fill_checker16(uint16_t *pixels, int stride, int x, int y, int w,
+                         int h, uint32_t first, uint32_t second);
+
+#endif
@@ -0,0 +1,130 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+struct trace_event {
+    const char *name;
+    uint64_t time_ns;
+    int64_t value;
+    char phase;
+};
+
+struct trace_ring {
+    struct trace_ring *next;
+    pid_t tid;
+    // only the owning thread writes; the exporter reads up to head
+    _Atomic uint64_t head;
+    struct trace_event events[TRACE_RING_SIZE];
+};
+
+static atomic_int enabled;
+static char *trace_path;
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct trace_ring *rings;
+static _Thread_local struct trace_ring *thread_ring;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static struct trace_ring *ring_create(void) {
+    struct trace_ring *ring = calloc(1, sizeof(*ring));
+    if (!ring) {
+        return NULL;
+    }
+    ring->tid = syscall(SYS_gettid);
+    pthread_mutex_lock(&rings_lock);
+    ring->next = rings;
+    rings = ring;
+    pthread_mutex_unlock(&rings_lock);
+    thread_ring = ring;
+    return ring;
+}
+
+void trace_init(void) {
+    const char *path = getenv("DEMOS_TRACE_FILE");
+    if (!path || !*path) {
+        return;
+    }
+    trace_path = strdup(path);
+    if (trace_path) {
+        atomic_store(&enabled, 1);
+    }
+}
+
+void trace_record(const char *name, char phase, int64_t value) {
+    if (!atomic_load_explicit(&enabled, memory_order_relaxed)) {
+        return;
+    }
+    struct trace_ring *ring = thread_ring;
+    if (!ring && !(ring = ring_create())) {
+        return;
+    }
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    struct trace_event *event = &ring->events[head % TRACE_RING_SIZE];
+    event->name = name;
+    event->time_ns = now_ns();
+    event->value = value;
+    event->phase = phase;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+static void write_event(FILE *out, const struct trace_event *event, pid_t pid,
+                        pid_t tid, int *first) {
+    fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,"
+            "\"pid\":%d,\"tid\":%d",
+            *first ? "" : ",", event->name, event->phase,
+            event->time_ns / 1e3, pid, tid);
+    if (event->phase == 'C') {
+        fprintf(out, ",\"args\":{\"value\":%lld}", (long long)event->value);
+    } else if (event->phase == 'i') {
+        fputs(",\"s\":\"t\"", out);
+    }
+    fputc('}', out);
+    *first = 0;
+}
+
+void trace_finish(void) {
+    if (!atomic_exchange(&enabled, 0)) {
+        return;
+    }
+    FILE *out = fopen(trace_path, "w");
+    if (!out) {
+        perror("fopen");
+        goto out;
+    }
+
+    // Threads that are still running may overwrite the oldest events
+    // while this reads them; recording is off now, so that is only the
+    // odd torn event from a thread caught mid-record.
+    pid_t pid = getpid();
+    int first = 1;
+    fputs("{\"traceEvents\":[", out);
+    pthread_mutex_lock(&rings_lock);
+    for (struct trace_ring *ring = rings; ring; ring = ring->next) {
+        uint64_t head =
+            atomic_load_explicit(&ring->head, memory_order_acquire);
+        uint64_t start = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+        for (uint64_t i = start; i < head; i++) {
+            write_event(out, &ring->events[i % TRACE_RING_SIZE], pid,
+                        ring->tid, &first);
+        }
+    }
+    pthread_mutex_unlock(&rings_lock);
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", out);
+    fclose(out);
+
+out:
+    free(trace_path);
+    trace_path = NULL;
+}
@@ -0,0 +1,39 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/*
+ * Chrome trace events (chrome://tracing, ui.perfetto.dev) recorded into
+ * per-thread ring buffers. The TRACE_* macros only exist in builds with
+ * DEMOS_TRACE defined (the DEMOS_TRACE CMake option) and expand to nothing
+ * otherwise. Even then nothing is recorded unless $DEMOS_TRACE_FILE was
+ * set at TRACE_INIT(); TRACE_FINISH() writes the JSON there.
+ *
+ * Each thread records into its own ring, so an event costs a clock read
+ * and a few stores with no locking. A full ring overwrites its oldest
+ * events. Names must be string literals: only the pointer is stored.
+ */
+#define TRACE_RING_SIZE 16384
+
+void trace_init(void);
+void trace_finish(void);
+void trace_record(const char *name, char phase, int64_t value);
+
+#ifdef DEMOS_TRACE
+#define TRACE_INIT() trace_init()
+#define TRACE_FINISH() trace_finish()
+#define TRACE_BEGIN(name) trace_record(name, 'B', 0)
+#define TRACE_END(name) trace_record(name, 'E', 0)
+#define TRACE_INSTANT(name) trace_record(name, 'i', 0)
+#define TRACE_COUNTER(name, value) trace_record(name, 'C', value)
+#else
+#define TRACE_INIT() ((void)0)
+#define TRACE_FINISH() ((void)0)
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+#define TRACE_COUNTER(name, value) ((void)sizeof(value))
+#endif
+
+#endif
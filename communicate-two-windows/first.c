@@ -1,69 +1,52 @@
 #include <wayland-client.h>
-#include "xdg-shell-client-header.h"
+#include "xdg-shell-client-protocol.h"
+#include "event-loop.h"
+#include "log.h"
+#include "renderer.h"
+#include "shm-format.h"
+#include "shm-pool.h"
+#include "size-channel.h"
+#include "solid-surface.h"
+#include "tile-render.h"
+#include "trace.h"
+#include <sys/epoll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <sys/socket.h>
-#include <sys/un.h>
-#include <sys/mman.h>
-#include <fcntl.h>
-#include <sys/stat.h>
 #include <stdint.h>
 
-#define FILE_NAME "./share_data.txt"
+#define MAX_FOLLOWERS 64
 
 struct state {
     struct wl_display *display;
     struct wl_registry *registry;
     struct wl_compositor *compositor;
     struct xdg_wm_base *wm_base;
+    struct wp_viewporter *viewporter;
+    struct wp_single_pixel_buffer_manager_v1 *single_pixel;
     struct wl_surface *surface;
     struct xdg_surface *xdg_surface;
     struct xdg_toplevel *toplevel;
 
     struct wl_shm *shm;
-    struct wl_buffer *buffer;
-    uint32_t *shm_data;
-    int shm_size;
-    FILE* file;
+    struct shm_pool pool;
+    struct renderer *renderer;
+    struct solid_surface solid;
+    struct event_loop loop;
+    int listen_fd;
+    struct size_record *record;
+    int record_fd;
+    int followers[MAX_FOLLOWERS];
+    int follower_count;
     int width, height;
-};
-
-int create_shm_buffer(struct state *state) {
-    int stride = state->width * 4;
-    int size = stride * state->height;
-
-    int fd = shm_open("/myshmf", O_CREAT | O_RDWR, 0600);
-    shm_unlink("/myshm");
-    if (fd < 0) {
-        perror("shm_open");
-        return -1;
-    }
-
-    if (ftruncate(fd, size) < 0) {
-        perror("ftruncate");
-        close(fd);
-        return -1;
-    }
 
-    state->shm_data =
-        mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    if (state->shm_data == MAP_FAILED) {
-        perror("mmap");
-        close(fd);
-        return -1;
-    }
-
-    struct wl_shm_pool *pool = wl_shm_create_pool(state->shm, fd, size);
-    state->buffer = wl_shm_pool_create_buffer(
-        pool, 0, state->width, state->height, stride, WL_SHM_FORMAT_ARGB8888);
-    wl_shm_pool_destroy(pool);
-    close(fd);
-
-    memset(state->shm_data, 0xFF, size);
-    return 0;
-}
+    // Scripted resizes for benchmarking the followers, see main()
+    struct event_source *script_timer;
+    int script_count;
+    int script_interval_ms;
+    int script_step;
+};
 
 static void xdg_wm_base_ping(void *data, struct xdg_wm_base *wm_base, uint32_t serial) {
     xdg_wm_base_pong(wm_base, serial);
@@ -75,31 +58,83 @@ static const struct xdg_wm_base_listener wm_base_listener = {
 
 static void xdg_surface_configure(void *data, struct xdg_surface *surface, uint32_t serial) {
     struct state *state = data;
+    TRACE_INSTANT("xdg_surface_configure");
     xdg_surface_ack_configure(surface, serial);
 
-    if (create_shm_buffer(state) < 0) {
-            fprintf(stderr, "Failed to create SHM buffer\n");
-            return;
-        }
-    wl_surface_attach(state->surface, state->buffer, 0, 0);
+    if (solid_surface_update(&state->solid, state->width, state->height,
+                             0xFFFFFFFF) < 0) {
+        log_error("Failed to create SHM buffer");
+        return;
+    }
+    TRACE_BEGIN("wl_surface_commit");
     wl_surface_commit(state->surface);
+    TRACE_END("wl_surface_commit");
 }
 
 static const struct xdg_surface_listener xdg_surface_listener = {
     .configure = xdg_surface_configure,
 };
 
+static void broadcast_size(struct state *state) {
+    TRACE_INSTANT("broadcast_size");
+    size_record_publish(state->record, state->width, state->height);
+    for (int i = 0; i < state->follower_count;) {
+        if (size_channel_notify(state->followers[i]) < 0) {
+            close(state->followers[i]);
+            state->followers[i] = state->followers[--state->follower_count];
+        } else {
+            i++;
+        }
+    }
+}
+
+// Broadcast a made-up size without touching the controller window, so the
+// followers can be measured without a compositor-driven resize.
+static void script_step(void *data, uint32_t expirations) {
+    struct state *state = data;
+    if (state->script_step == state->script_count) {
+        // One quiet interval for the last commits, then let followers go
+        event_loop_quit(&state->loop);
+        return;
+    }
+    state->script_step++;
+    state->width = 300 + (state->script_step * 37) % 300;
+    state->height = 300 + (state->script_step * 53) % 300;
+    broadcast_size(state);
+}
+
+static void accept_followers(void *data, uint32_t events) {
+    struct state *state = data;
+    int fd;
+    while ((fd = size_channel_accept(state->listen_fd)) >= 0) {
+        if (state->follower_count == MAX_FOLLOWERS) {
+            log_warn("Too many followers");
+            close(fd);
+            continue;
+        }
+        if (size_channel_send_record(fd, state->record_fd) < 0) {
+            close(fd);
+            continue;
+        }
+        state->followers[state->follower_count++] = fd;
+        if (state->script_count && !state->script_step) {
+            event_source_timer_update(state->script_timer,
+                                      state->script_interval_ms,
+                                      state->script_interval_ms);
+        }
+    }
+}
+
 static void xdg_toplevel_configure(void *data, struct xdg_toplevel *toplevel,
                                    int32_t width, int32_t height,
                                    struct wl_array *states) {
     struct state *state = data;
+    TRACE_INSTANT("xdg_toplevel_configure");
     if (width > 0 && height > 0) {
         state->width = width;
         state->height = height;
-        printf("Resizing to %dx%d\n", width, height);
-        fseek(state->file, 0, SEEK_SET);
-        fprintf(state->file,"%d\n%d\n", state->height, state->width);
-        fflush(state->file);
+        log_info("Resizing to %dx%d", width, height);
+        broadcast_size(state);
     }
 }
 
@@ -121,6 +156,16 @@ static void registry_global(void *data, struct wl_registry *registry,
         xdg_wm_base_add_listener(state->wm_base, &wm_base_listener, NULL);
     } else if (strcmp(interface, wl_shm_interface.name) == 0) {
         state->shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+        shm_format_listen(state->shm);
+    } else if (strcmp(interface, wp_viewporter_interface.name) == 0) {
+        state->viewporter = wl_registry_bind(
+            registry, name, &wp_viewporter_interface, 1);
+#ifdef DEMOS_HAVE_SINGLE_PIXEL_BUFFER
+    } else if (strcmp(interface,
+                      wp_single_pixel_buffer_manager_v1_interface.name) == 0) {
+        state->single_pixel = wl_registry_bind(
+            registry, name, &wp_single_pixel_buffer_manager_v1_interface, 1);
+#endif
     }
 }
 
@@ -129,11 +174,39 @@ static const struct wl_registry_listener registry_listener = {
 };
 
 
-int main() {
+// Usage: first [resizes [interval_ms]]
+// With a resize count, the controller broadcasts that many sizes once the
+// first follower connects (every interval_ms, default 16) and then exits.
+// Scripted sizes are published directly and never go through
+// xdg_toplevel.configure, so they measure the followers alone.
+int main(int argc, char **argv) {
     struct state state = {0};
+    log_init();
+    TRACE_INIT();
+    tile_render_init(0);
+    state.renderer = renderer_create(NULL);
+    if (!state.renderer) {
+        return 1;
+    }
     state.width = 400;
     state.height = 400;
-    state.file = fopen(FILE_NAME, "w");
+    state.script_count = argc > 1 ? atoi(argv[1]) : 0;
+    state.script_interval_ms = argc > 2 ? atoi(argv[2]) : 16;
+    if (state.script_count < 0 || state.script_interval_ms <= 0) {
+        fprintf(stderr, "Usage: %s [resizes [interval_ms]]\n", argv[0]);
+        return 1;
+    }
+    state.listen_fd = size_channel_listen();
+    if (state.listen_fd < 0) {
+        fprintf(stderr, "Failed to open the size channel\n");
+        return 1;
+    }
+    state.record = size_record_create(&state.record_fd);
+    if (!state.record) {
+        fprintf(stderr, "Failed to create the size record\n");
+        return 1;
+    }
+    size_record_publish(state.record, state.width, state.height);
     // Connect to Wayland
     state.display = wl_display_connect(NULL);
     if (!state.display) {
@@ -145,13 +218,17 @@ int main() {
     wl_registry_add_listener(state.registry, &registry_listener, &state);
     wl_display_roundtrip(state.display);
     
-    if (!state.compositor || !state.wm_base) {
+    if (!state.compositor || !state.wm_base || !state.shm) {
         fprintf(stderr, "Missing required globals\n");
         return 1;
     }
+    shm_pool_init(&state.pool, state.shm, 3);
     
     // Create window
     state.surface = wl_compositor_create_surface(state.compositor);
+    solid_surface_init(&state.solid, state.compositor, state.surface,
+                       &state.pool, state.renderer, state.viewporter,
+                       state.single_pixel);
     state.xdg_surface = xdg_wm_base_get_xdg_surface(state.wm_base, state.surface);
     xdg_surface_add_listener(state.xdg_surface, &xdg_surface_listener, &state);
     state.toplevel = xdg_surface_get_toplevel(state.xdg_surface);
@@ -163,16 +240,45 @@ int main() {
     wl_surface_commit(state.surface);
 
     wl_display_roundtrip(state.display); // Ensure shm is bound
-    wl_surface_attach(state.surface, state.buffer, 0, 0);
-    wl_surface_damage_buffer(state.surface, 0, 0, state.width, state.height);
     wl_surface_commit(state.surface);
     
-    // Main loop
-    while (wl_display_dispatch(state.display) != -1) {
-        // Keep handling events
+    // Main loop: Wayland events and followers connecting
+    if (event_loop_init(&state.loop, state.display, NULL) < 0) {
+        return 1;
     }
+    struct event_source *listen_source = event_loop_add_fd(
+        &state.loop, state.listen_fd, EPOLLIN, accept_followers, &state);
+    if (state.script_count) {
+        state.script_timer = event_loop_add_timer(&state.loop, script_step,
+                                                  &state);
+    }
+    event_loop_run(&state.loop);
+    if (state.script_timer) {
+        event_source_remove(state.script_timer);
+    }
+    event_source_remove(listen_source);
+    event_loop_finish(&state.loop);
     
-    fclose(state.file);
+    solid_surface_finish(&state.solid);
+    shm_pool_finish(&state.pool);
+    if (state.viewporter) {
+        wp_viewporter_destroy(state.viewporter);
+    }
+#ifdef DEMOS_HAVE_SINGLE_PIXEL_BUFFER
+    if (state.single_pixel) {
+        wp_single_pixel_buffer_manager_v1_destroy(state.single_pixel);
+    }
+#endif
+    for (int i = 0; i < state.follower_count; i++) {
+        close(state.followers[i]);
+    }
+    close(state.listen_fd);
+    size_record_unmap(state.record);
+    close(state.record_fd);
     wl_display_disconnect(state.display);
+    renderer_destroy(state.renderer);
+    tile_render_finish();
+    TRACE_FINISH();
+    log_finish();
     return 0;
 }
\ No newline at end of file
@@ -1,70 +1,70 @@
 #include <wayland-client.h>
-#include "xdg-shell-client-header.h"
+#include "xdg-shell-client-protocol.h"
+#include "frame-scheduler.h"
+#include "latency-stats.h"
+#include "log.h"
+#include "event-loop.h"
+#include "renderer.h"
+#include "shm-alloc.h"
+#include "shm-format.h"
+#include "shm-pool.h"
+#include "size-channel.h"
+#include "solid-surface.h"
+#include "tile-render.h"
+#include "trace.h"
+#include <sys/epoll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <sys/socket.h>
-#include <sys/select.h>
-#include <sys/un.h>
-#include <sys/mman.h>
-#include <fcntl.h>
-#include <sys/stat.h>
 #include <stdint.h>
+#include <time.h>
 
-#define FILE_NAME "./share_data.txt"
+#define MAX_WINDOWS 64
 
-struct state {
-    struct wl_display *display;
-    struct wl_registry *registry;
-    struct wl_compositor *compositor;
-    struct xdg_wm_base *wm_base;
+struct state;
+
+// One follower window. All of them share the state's connection and
+// globals and follow the same controller size.
+struct follower {
+    struct state *state;
     struct wl_surface *surface;
     struct xdg_surface *xdg_surface;
     struct xdg_toplevel *toplevel;
-    
-    struct wl_shm *shm;
-    struct wl_buffer *buffer;
-    uint32_t *shm_data;
-    int shm_size;
 
-    FILE* file;
+    struct shm_pool pool;
+    struct frame_scheduler scheduler;
+    struct solid_surface solid;
+    int configured;
     int width, height;
+    uint64_t resize_ns;
 };
 
-int create_shm_buffer(struct state *state) {
-    int stride = state->width * 4;
-    int size = stride * state->height;
-
-    int fd = shm_open("/myshms", O_CREAT | O_RDWR, 0600);
-    shm_unlink("/myshms");
-    if (fd < 0) {
-        perror("shm_open");
-        return -1;
-    }
-
-    if (ftruncate(fd, size) < 0) {
-        perror("ftruncate");
-        close(fd);
-        return -1;
-    }
+struct state {
+    struct wl_display *display;
+    struct wl_registry *registry;
+    struct wl_compositor *compositor;
+    struct xdg_wm_base *wm_base;
+    struct wl_shm *shm;
+    struct wp_viewporter *viewporter;
+    struct wp_single_pixel_buffer_manager_v1 *single_pixel;
 
-    state->shm_data =
-        mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    if (state->shm_data == MAP_FAILED) {
-        perror("mmap");
-        close(fd);
-        return -1;
-    }
+    struct follower followers[MAX_WINDOWS];
+    int follower_count;
+    struct renderer *renderer;
 
-    struct wl_shm_pool *pool = wl_shm_create_pool(state->shm, fd, size);
-    state->buffer = wl_shm_pool_create_buffer(
-        pool, 0, state->width, state->height, stride, WL_SHM_FORMAT_ARGB8888);
-    wl_shm_pool_destroy(pool);
-    close(fd);
+    struct event_loop loop;
+    int channel_fd;
+    struct size_record *record;
+    uint32_t serial;
+    // Time from the controller publishing a size to a follower committing it
+    struct latency_stats latency;
+};
 
-    memset(state->shm_data, 100, size);
-    return 0;
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
 }
 
 static void xdg_wm_base_ping(void *data, struct xdg_wm_base *wm_base, uint32_t serial) {
@@ -75,16 +75,32 @@ static const struct xdg_wm_base_listener wm_base_listener = {
     .ping = xdg_wm_base_ping,
 };
 
+static int redraw(void *data) {
+    struct follower *follower = data;
+    if (solid_surface_update(&follower->solid, follower->width,
+                             follower->height, 0x64646464) < 0) {
+        log_error("Failed to create SHM buffer");
+        wl_surface_commit(follower->surface);
+        return -1;
+    }
+    TRACE_BEGIN("wl_surface_commit");
+    wl_surface_commit(follower->surface);
+    TRACE_END("wl_surface_commit");
+
+    if (follower->resize_ns) {
+        latency_stats_add(&follower->state->latency,
+                          now_ns() - follower->resize_ns);
+        follower->resize_ns = 0;
+    }
+    return 0;
+}
+
 static void xdg_surface_configure(void *data, struct xdg_surface *surface, uint32_t serial) {
-    struct state *state = data;
+    struct follower *follower = data;
+    TRACE_INSTANT("xdg_surface_configure");
     xdg_surface_ack_configure(surface, serial);
-    
-    if (create_shm_buffer(state) < 0) {
-            fprintf(stderr, "Failed to create SHM buffer\n");
-            return;
-        }
-    wl_surface_attach(state->surface, state->buffer, 0, 0);
-    wl_surface_commit(state->surface);
+    follower->configured = 1;
+    frame_scheduler_schedule(&follower->scheduler);
 }
 
 static const struct xdg_surface_listener xdg_surface_listener = {
@@ -104,10 +120,20 @@ static void registry_global(void *data, struct wl_registry *registry,
     } else if (strcmp(interface, wl_shm_interface.name) == 0) {
         state->shm = wl_registry_bind(
             registry, name, &wl_shm_interface, 1);
+        shm_format_listen(state->shm);
     } else if (strcmp(interface, xdg_wm_base_interface.name) == 0) {
         state->wm_base = wl_registry_bind(
             registry, name, &xdg_wm_base_interface, 1);
         xdg_wm_base_add_listener(state->wm_base, &wm_base_listener, NULL);
+    } else if (strcmp(interface, wp_viewporter_interface.name) == 0) {
+        state->viewporter = wl_registry_bind(
+            registry, name, &wp_viewporter_interface, 1);
+#ifdef DEMOS_HAVE_SINGLE_PIXEL_BUFFER
+    } else if (strcmp(interface,
+                      wp_single_pixel_buffer_manager_v1_interface.name) == 0) {
+        state->single_pixel = wl_registry_bind(
+            registry, name, &wp_single_pixel_buffer_manager_v1_interface, 1);
+#endif
     }
 }
 
@@ -125,26 +151,114 @@ static const struct wl_registry_listener registry_listener = {
 
 
 
-void resize_window(struct state *state, int width, int height) {
+void resize_window(struct follower *follower, int width, int height,
+                   uint64_t time_ns) {
     if (width > 0 && height > 0) {
-        state->width = width;
-        state->height = height;
-        printf("Resizing to %dx%d\n", width, height);
-        if (create_shm_buffer(state) < 0) {
-            fprintf(stderr, "Failed to create SHM buffer\n");
-            return;
+        follower->width = width;
+        follower->height = height;
+        // a size superseded before it was drawn still waited since it was
+        // published, so measure from the oldest one
+        if (!follower->resize_ns) {
+            follower->resize_ns = time_ns;
+        }
+        // before the first configure the size is simply picked up by it
+        if (follower->configured) {
+            frame_scheduler_schedule(&follower->scheduler);
         }
-        wl_surface_attach(state->surface, state->buffer, 0, 0);
-        wl_surface_commit(state->surface);
     }
 }
 
-int main() {
+// Every window is resized here, but their commits only sit in the
+// connection buffer until the event loop flushes it once before going back
+// to sleep, so the whole group reaches the compositor in one write.
+static void handle_controller(void *data, uint32_t events) {
+    struct state *state = data;
+    TRACE_INSTANT("handle_controller");
+    int record_fd = -1;
+    int ret = size_channel_recv(state->channel_fd, &record_fd);
+    if (ret < 0) {
+        log_info("Controller went away");
+        event_loop_quit(&state->loop);
+        return;
+    }
+    if (record_fd >= 0) {
+        if (state->record) {
+            size_record_unmap(state->record);
+        }
+        state->record = size_record_map(record_fd);
+        close(record_fd);
+    }
+    if (ret == 0 || !state->record) {
+        return;
+    }
+
+    int width, height;
+    uint64_t time_ns;
+    uint32_t serial =
+        size_record_read(state->record, &width, &height, &time_ns);
+    if (serial == state->serial) {
+        return;
+    }
+    state->serial = serial;
+    for (int i = 0; i < state->follower_count; i++) {
+        struct follower *follower = &state->followers[i];
+        if (height != follower->height || width != follower->width) {
+            resize_window(follower, width, height, time_ns);
+        }
+    }
+}
+
+static void create_window(struct state *state, struct follower *follower) {
+    follower->state = state;
+    follower->width = 400;
+    follower->height = 400;
+    shm_pool_init(&follower->pool, state->shm, 3);
+
+    follower->surface = wl_compositor_create_surface(state->compositor);
+    solid_surface_init(&follower->solid, state->compositor, follower->surface,
+                       &follower->pool, state->renderer, state->viewporter,
+                       state->single_pixel);
+    frame_scheduler_init(&follower->scheduler, follower->surface, redraw,
+                         follower);
+    follower->xdg_surface =
+        xdg_wm_base_get_xdg_surface(state->wm_base, follower->surface);
+    xdg_surface_add_listener(follower->xdg_surface, &xdg_surface_listener,
+                             follower);
+    follower->toplevel = xdg_surface_get_toplevel(follower->xdg_surface);
+    xdg_toplevel_set_title(follower->toplevel, "Follower Window");
+    xdg_toplevel_set_app_id(follower->toplevel, "follower");
+
+    // Set initial size
+    wl_surface_commit(follower->surface);
+}
+
+static void destroy_window(struct follower *follower) {
+    frame_scheduler_finish(&follower->scheduler);
+    xdg_toplevel_destroy(follower->toplevel);
+    xdg_surface_destroy(follower->xdg_surface);
+    solid_surface_finish(&follower->solid);
+    wl_surface_destroy(follower->surface);
+    shm_pool_finish(&follower->pool);
+}
+
+// Usage: second [windows]
+// Opens that many follower windows (default 1) on one connection.
+int main(int argc, char **argv) {
     struct state state = {0};
-    state.width = 400;
-    state.height = 400;
-    
-    state.file = fopen(FILE_NAME, "r");
+    log_init();
+    TRACE_INIT();
+    tile_render_init(0);
+    state.renderer = renderer_create(NULL);
+    if (!state.renderer) {
+        return 1;
+    }
+    latency_stats_init(&state.latency);
+    state.follower_count = argc > 1 ? atoi(argv[1]) : 1;
+    if (state.follower_count < 1 || state.follower_count > MAX_WINDOWS) {
+        fprintf(stderr, "Window count must be between 1 and %d\n",
+                MAX_WINDOWS);
+        return 1;
+    }
     
     // Connect to Wayland
     state.display = wl_display_connect(NULL);
@@ -157,42 +271,74 @@ int main() {
     wl_registry_add_listener(state.registry, &registry_listener, &state);
     wl_display_roundtrip(state.display);
     
-    if (!state.compositor || !state.wm_base) {
+    if (!state.compositor || !state.wm_base || !state.shm) {
         fprintf(stderr, "Missing required globals\n");
         return 1;
     }
     
-    // Create window
-    state.surface = wl_compositor_create_surface(state.compositor);
-    state.xdg_surface = xdg_wm_base_get_xdg_surface(state.wm_base, state.surface);
-    xdg_surface_add_listener(state.xdg_surface, &xdg_surface_listener, &state);
-    state.toplevel = xdg_surface_get_toplevel(state.xdg_surface);
-    xdg_toplevel_set_title(state.toplevel, "Follower Window");
-    xdg_toplevel_set_app_id(state.toplevel, "follower");
-    
-    // Set initial size
-    wl_surface_commit(state.surface);
+    // Create windows
+    for (int i = 0; i < state.follower_count; i++) {
+        create_window(&state, &state.followers[i]);
+    }
+    wl_display_roundtrip(state.display); // Wait for the first configures
 
-    wl_display_roundtrip(state.display); // Ensure shm is bound
-    // wl_surface_attach(state.surface, state.buffer, 0, 0);
-    // wl_surface_damage_buffer(state.surface, 0, 0, state.width, state.height);
-    // wl_surface_commit(state.surface);
+    // Only follow the controller once every window is on screen
+    state.channel_fd = size_channel_connect();
+    if (state.channel_fd < 0) {
+        fprintf(stderr, "Failed to connect to the controller\n");
+        return 1;
+    }
     
-    // Main loop with socket monitoring
-    while (wl_display_dispatch(state.display) != -1) {
-        
-        int height, width;
-        fflush(state.file);
-        fseek(state.file, 0, SEEK_SET);
-        fscanf(state.file, "%d\n%d\n" , &height, &width);
-        if (height != state.height || width != state.width) {
-            printf("Received resize request: %dx%d\n", height, width);
-            resize_window(&state, width, height);
+    // Main loop: sleep until either Wayland or the controller has news
+    if (event_loop_init(&state.loop, state.display, NULL) < 0) {
+        return 1;
+    }
+    struct event_source *channel_source = event_loop_add_fd(
+        &state.loop, state.channel_fd, EPOLLIN, handle_controller, &state);
+    event_loop_run(&state.loop);
+    event_source_remove(channel_source);
+    event_loop_finish(&state.loop);
+
+    if (state.latency.count) {
+        char label[32];
+        snprintf(label, sizeof(label), "windows=%d", state.follower_count);
+        latency_stats_print(&state.latency, stdout, label);
+
+        // the group as one scheduler: totals and the tightest budget
+        struct frame_scheduler total = state.followers[0].scheduler;
+        for (int i = 1; i < state.follower_count; i++) {
+            const struct frame_scheduler *sched = &state.followers[i].scheduler;
+            total.frames += sched->frames;
+            total.coalesced += sched->coalesced;
+            if (sched->min_budget_ms < total.min_budget_ms) {
+                total.min_budget_ms = sched->min_budget_ms;
+            }
         }
+        frame_scheduler_print_stats(&total, stdout, label);
+        shm_alloc_print_stats(stdout);
     }
+    latency_stats_finish(&state.latency);
     
     // Cleanup
-    fclose(state.file);
+    for (int i = 0; i < state.follower_count; i++) {
+        destroy_window(&state.followers[i]);
+    }
+    if (state.record) {
+        size_record_unmap(state.record);
+    }
+    close(state.channel_fd);
+    if (state.viewporter) {
+        wp_viewporter_destroy(state.viewporter);
+    }
+#ifdef DEMOS_HAVE_SINGLE_PIXEL_BUFFER
+    if (state.single_pixel) {
+        wp_single_pixel_buffer_manager_v1_destroy(state.single_pixel);
+    }
+#endif
     wl_display_disconnect(state.display);
+    renderer_destroy(state.renderer);
+    tile_render_finish();
+    TRACE_FINISH();
+    log_finish();
     return 0;
-}
\ No newline at end of file
+}
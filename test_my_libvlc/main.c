@@ -20,7 +20,15 @@
 #include <wayland-client.h>
 
 #include "xdg-foreign-unstable-v2-client-protocol.h"
-#include "xdg-shell-client-header.h"
+#include "xdg-shell-client-protocol.h"
+#include "event-loop.h"
+#include "log.h"
+#include "opaque-region.h"
+#include "renderer.h"
+#include "shm-format.h"
+#include "shm-pool.h"
+#include "tile-render.h"
+#include "trace.h"
 
 struct wl_display *display;
 struct wl_event_queue *queue;
@@ -28,6 +36,10 @@ struct wl_compositor *compositor;
 struct wl_surface *surface;
 struct wl_buffer *buffer;
 struct wl_shm *shm;
+struct shm_pool pool;
+struct event_loop loop;
+struct renderer *renderer;
+struct opaque_region opaque_region;
 struct xdg_wm_base *xdg_wm_base;
 struct xdg_toplevel *toplevel;
 struct wl_seat *seat;
@@ -48,6 +60,8 @@ libvlc_media_t *media;
 libvlc_media_player_t *mp;
 libvlc_video_output_resize_cb report_size_change;
 void *opaque;
+int reported_width = 0;
+int reported_height = 0;
 //////////////////
 
 void set_callbacks(void* data,
@@ -56,96 +70,67 @@ void set_callbacks(void* data,
         libvlc_video_output_mouse_press_cb report_mouse_press_,
         libvlc_video_output_mouse_release_cb report_mouse_release_,
         void* reportOpaqu) {
+    TRACE_INSTANT("set_callbacks");
     
     report_size_change = report_size_change_;
     opaque = reportOpaqu;
-    printf("report opaque %p\n", reportOpaqu);
+    log_debug("report opaque %p", reportOpaqu);
     
 }
 
-int allocate_shm(uint64_t size) {
-    int8_t name[8];
-    name[0] = '/';
-    name[7] = 0;
-    for (int i = 1; i < 7; i++) {
-        name[i] = 'a' + (rand() % 26);
-    }
-    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL,
-                      S_IWUSR | S_IRUSR | S_IWOTH | S_IROTH);
-
-    if (fd < 0) {
-        perror("shm_open");
-        return -1;
-    }
-    shm_unlink(name);
-    if (ftruncate(fd, size) == -1) {
-        perror("ftruncate");
-        close(fd);
-        return -1;
-    }
-
-    return fd;
-}
-
-void resize() {
-    int fd = allocate_shm(width * height * 4);
-    if (fd < 0) {
-        return;
-    }
-    shm_data = mmap(NULL, width * height * 4, PROT_READ | PROT_WRITE,
-                    MAP_SHARED, fd, 0);
-
-    if (shm_data == MAP_FAILED) {
-        perror("mmap");
-        close(fd);
-        shm_data = NULL;
-        return;
-    }
-
-    struct wl_shm_pool *pool = wl_shm_create_pool(shm, fd, width * height * 4);
-    buffer = wl_shm_pool_create_buffer(pool, 0, width, height, width * 4,
-                                       WL_SHM_FORMAT_ARGB8888);
-    wl_shm_pool_destroy(pool);
-    pool = NULL;
-    close(fd);
-}
-
 void invert_chess_board_colors() {
     uint32_t tmp = first_color;
     first_color = second_color;
     second_color = tmp;
 }
 
-void draw_chess_board() {
-    uint32_t *pixels = (uint32_t *)shm_data;
-    for (int x = 0; x < width; x++) {
-        for (int y = 0; y < height; y++) {
-            if ((x + y / 8 * 8) % 16 < 8) {
-                pixels[y * width + x] = first_color;
-            } else {
-                pixels[y * width + x] = second_color;
-            }
-        }
-    }
+void draw_chess_board(struct shm_slot *slot) {
+    TRACE_BEGIN("draw_chess_board");
+    shm_slot_begin_frame(slot, renderer);
+    renderer_checker(renderer, 0, 0, width, height, first_color,
+                     second_color);
+    renderer_end_frame(renderer);
+    TRACE_END("draw_chess_board");
 }
 
 void draw() {
     // memset(shm_data, color, width * height * 4);
 
-    draw_chess_board();
+    pool.format = shm_format_select((first_color & second_color) >> 24 == 0xFF);
+    struct shm_slot *slot = shm_pool_acquire(&pool, width, height);
+    if (!slot) {
+        // every buffer is still held by the compositor, wait for a release
+        return;
+    }
+    buffer = slot->buffer;
+    shm_data = (uint8_t *)slot->data;
+
+    draw_chess_board(slot);
+    opaque_region_from_renderer(&opaque_region, renderer, width, height);
 
     wl_surface_attach(surface, buffer, 0, 0);
     wl_surface_damage_buffer(surface, 0, 0, width, height);
+    TRACE_BEGIN("wl_surface_commit");
     wl_surface_commit(surface);
+    TRACE_END("wl_surface_commit");
 }
 
 void xdg_surface_configure(void *data, struct xdg_surface *xdg_surface,
                            uint32_t serial) {
+    TRACE_BEGIN("xdg_surface_configure");
     xdg_surface_ack_configure(xdg_surface, serial);
-    if (!shm_data) {
-        resize();
-    }
     draw();
+    // A resize storm sends many toplevel configures, tell vlc only about
+    // the size that actually got drawn, and only when it changed.
+    if (report_size_change != NULL &&
+        (width != reported_width || height != reported_height)) {
+        TRACE_BEGIN("report_size_change");
+        report_size_change(opaque, width, height);
+        TRACE_END("report_size_change");
+        reported_width = width;
+        reported_height = height;
+    }
+    TRACE_END("xdg_surface_configure");
 }
 
 struct xdg_surface_listener xdg_surface_listener = {
@@ -159,15 +144,8 @@ void xdg_toplevel_configure(void *data, struct xdg_toplevel *xdg_toplevel,
     if (new_width <= 0 || new_height <= 0) {
         return;
     }
-    if (width != new_width || height != new_height) {
-        munmap(shm_data, width * height * 4);
-        width = new_width;
-        height = new_height;
-        resize();
-    }
-    if (report_size_change != NULL) {
-        report_size_change(opaque, width, height);
-    }
+    width = new_width;
+    height = new_height;
 }
 
 void xdg_toplevel_close(void *data, struct xdg_toplevel *xdg_toplevel) {
@@ -197,13 +175,19 @@ void keyboard_key(void *data, struct wl_keyboard *wl_keyboard, uint32_t serial,
     if (key == 1) {  // escape character
         close_flag = 1;
     } else if (key == 30) {  // 'a' key
-        printf("'a' is pressed.\n");
+        log_info("'a' is pressed.");
         assert(report_size_change != NULL);
+        TRACE_BEGIN("report_size_change");
         report_size_change(opaque,200,200);
+        TRACE_END("report_size_change");
+        reported_width = reported_height = 200;
     } else if (key == 32) {  // 'd' key
-        printf("'d' is pressed.\n");
+        log_info("'d' is pressed.");
         assert(report_size_change != NULL);
+        TRACE_BEGIN("report_size_change");
         report_size_change(opaque,800,800);
+        TRACE_END("report_size_change");
+        reported_width = reported_height = 800;
     }
 }
 
@@ -248,7 +232,7 @@ void pointer_motion(void *data, struct wl_pointer *wl_pointer, uint32_t time,
 void pointer_button(void *data, struct wl_pointer *wl_pointer, uint32_t serial,
                     uint32_t time, uint32_t button, uint32_t state) {
     if (state == WL_POINTER_BUTTON_STATE_PRESSED) {
-        printf("mouse clicked!!\n");
+        log_info("mouse clicked");
         invert_chess_board_colors();
     }
 }
@@ -300,6 +284,7 @@ void registry_global(void *data, struct wl_registry *registry, uint32_t id,
             wl_registry_bind(registry, id, &wl_compositor_interface, 4);
     } else if (!strcmp(interface, wl_shm_interface.name)) {
         shm = wl_registry_bind(registry, id, &wl_shm_interface, 1);
+        shm_format_listen(shm);
     } else if (!strcmp(interface, xdg_wm_base_interface.name)) {
         xdg_wm_base = wl_registry_bind(registry, id, &xdg_wm_base_interface, 1);
         xdg_wm_base_add_listener(xdg_wm_base, &xdg_wm_base_listener, NULL);
@@ -311,7 +296,7 @@ void registry_global(void *data, struct wl_registry *registry, uint32_t id,
 
 void registry_global_remove(void *data, struct wl_registry *registry,
                             uint32_t id) {
-    printf("Global remove: %u\n", id);
+    log_info("Global remove: %u", id);
 }
 
 struct wl_registry_listener listener = {
@@ -336,14 +321,9 @@ void clean_up() {
         wl_surface_destroy(surface);
         surface = NULL;
     }
-    if (buffer) {
-        wl_buffer_destroy(buffer);
-        buffer = NULL;
-    }
-    if (shm_data) {
-        munmap(shm_data, width * height * 4);
-        shm_data = NULL;
-    }
+    shm_pool_finish(&pool);
+    buffer = NULL;
+    shm_data = NULL;
     if (keyboard) {
         wl_keyboard_destroy(keyboard);
         keyboard = NULL;
@@ -361,6 +341,7 @@ void clean_up() {
 
 void window_init() {
     surface = wl_compositor_create_surface(compositor);
+    opaque_region_init(&opaque_region, compositor, surface);
     
     xdg_surface = xdg_wm_base_get_xdg_surface(xdg_wm_base, surface);
     xdg_surface_add_listener(xdg_surface, &xdg_surface_listener, NULL);
@@ -371,8 +352,8 @@ void window_init() {
 
 }
 
-void handle_sigint(int sig) {
-    printf("Received signal %d, cleaning up...\n", sig);
+void handle_signal(void *data, uint32_t sig) {
+    log_info("Received signal %d, cleaning up...", sig);
     close_flag = 1;
 }
 
@@ -412,12 +393,16 @@ void init_vlc() {
 
 int main(int argc, char *argv[])
 {
+    log_init();
+    TRACE_INIT();
+    tile_render_init(0);
+    renderer = renderer_create(NULL);
+    if (!renderer) {
+        return -1;
+    }
     
 
-    signal(SIGINT, handle_sigint);
-    signal(SIGTERM, handle_sigint);
 
-    
     display = wl_display_connect(NULL);
     if (display == NULL) {
         printf("Failed to connect to Wayland display\n");
@@ -434,17 +419,27 @@ int main(int argc, char *argv[])
     wl_registry_add_listener(registry, &listener, NULL);
     wl_proxy_set_queue((struct wl_proxy *)registry, queue);
     wl_display_roundtrip_queue(display, queue);
-    
+    shm_pool_init(&pool, shm, 3);
+
     window_init();
     wl_surface_commit(surface);
     
+    // before libvlc starts its threads, so they inherit the signal mask
+    if (event_loop_init(&loop, display, queue) < 0) {
+        return -1;
+    }
+    struct event_source *sigint =
+        event_loop_add_signal(&loop, SIGINT, handle_signal, NULL);
+    struct event_source *sigterm =
+        event_loop_add_signal(&loop, SIGTERM, handle_signal, NULL);
+
     init_vlc();
 
-    while (wl_display_dispatch_queue(display, queue) != -1) {
-        if (close_flag) {
-            break;
-        }
+    while (!close_flag && event_loop_dispatch(&loop, -1) == 0) {
     }
+    event_source_remove(sigint);
+    event_source_remove(sigterm);
+    event_loop_finish(&loop);
     wl_display_roundtrip(display);
     if (surface && buffer) {
         wl_surface_attach(surface, NULL, 0, 0);
@@ -459,6 +454,10 @@ int main(int argc, char *argv[])
     libvlc_media_player_stop_async(mp);
     libvlc_media_player_release(mp);
     libvlc_release(vlc);
+    renderer_destroy(renderer);
+    tile_render_finish();
+    TRACE_FINISH();
+    log_finish();
 
     return 0;
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <signal.h>
@@ -10,18 +11,38 @@
 #include <wayland-client.h>
 
 #include "xdg-foreign-unstable-v2-client-protocol.h"
-#include "xdg-shell-client-header.h"
+#include "xdg-shell-client-protocol.h"
+#include "viewporter-client-protocol.h"
+#include "damage.h"
+#include "event-loop.h"
+#include "frame-scheduler.h"
+#include "latency-stats.h"
+#include "log.h"
+#include "opaque-region.h"
+#include "renderer.h"
+#include "shm-alloc.h"
+#include "shm-format.h"
+#include "shm-pool.h"
+#include "solid-surface.h"
+#include "tile-render.h"
+#include "trace.h"
 
 struct wl_compositor *compositor;
 struct wl_surface *surface;
 struct wl_buffer *buffer;
 struct wl_shm *shm;
+struct shm_pool pool;
+struct event_loop loop;
+struct frame_scheduler scheduler;
+struct renderer *renderer;
 struct xdg_wm_base *xdg_wm_base;
 struct xdg_toplevel *toplevel;
 struct wl_seat *seat;
 struct wl_keyboard *keyboard;
 struct wl_pointer *pointer;
 struct xdg_surface *xdg_surface;
+struct wp_viewporter *viewporter;
+struct wp_viewport *viewport;
 struct zxdg_exporter_v2 *exporter = NULL;
 struct zxdg_exported_v2 *exported = NULL;
 char *exported_handle = NULL;
@@ -32,99 +53,241 @@ int8_t color = 0;
 uint8_t close_flag = 0;
 uint32_t first_color = 0xFF666666;
 uint32_t second_color = 0xFFEEEEEE;
+struct damage frame_damage;
+struct opaque_region opaque;
+struct latency_stats draw_times;
+
+// Scripted run for benchmarking and PGO training, see main()
+struct event_source *script_timer;
+int script_steps;
+int script_step;
+
+// While the window is being resized, draw() renders into a buffer padded
+// past the window size and only reallocates once the window outgrows it.
+// The buffer is shrunk back to the exact size once no configure has
+// arrived for RESIZE_SETTLE_MS.
+#define RESIZE_SETTLE_MS 250
+struct event_source *settle_timer;
+int live_resize = 0;
+int buffer_width = 0;
+int buffer_height = 0;
+int shown_width = 0;
+int shown_height = 0;
+
+// With a viewport ($DEMOS_VIEWPORT) the board fills the whole buffer and
+// the surface shows a width x height crop of it. The board is anchored at
+// the origin, so any crop is the board of that size, and a resize that
+// fits the attached buffer only needs a new source and destination.
+struct shm_slot *shown_slot;
+
+// Colours and window size each pool slot was last painted with. The slots
+// rotate, so this is what tells draw_chess_board() how far behind a slot
+// is, like a buffer age would.
+struct board {
+    uint32_t first, second;
+    int width, height;
+};
+struct board boards[SHM_POOL_MAX_SLOTS];
 
 void handle_exported(void *data, struct zxdg_exported_v2 *zxdg_exported_v2,
                      const char *handle) {
     exported_handle = strdup(handle);
     printf("Handle: %s\n", exported_handle);
+    // scripts wait for this line, so don't leave it in a pipe buffer
+    fflush(stdout);
 }
 
 struct zxdg_exported_v2_listener exported_listener = {.handle =
                                                           handle_exported};
 
-int allocate_shm(uint64_t size) {
-    int8_t name[8];
-    name[0] = '/';
-    name[7] = 0;
-    for (int i = 1; i < 7; i++) {
-        name[i] = 'a' + (rand() % 26);
-    }
-    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL,
-                      S_IWUSR | S_IRUSR | S_IWOTH | S_IROTH);
+void invert_chess_board_colors() {
+    uint32_t tmp = first_color;
+    first_color = second_color;
+    second_color = tmp;
+    // every square changes colour, so there is no smaller damage to give
+    damage_add(&frame_damage, 0, 0, width, height);
+}
 
-    if (fd < 0) {
-        perror("shm_open");
-        return -1;
-    }
-    shm_unlink(name);
-    if (ftruncate(fd, size) == -1) {
-        perror("ftruncate");
-        close(fd);
-        return -1;
-    }
+// Adds what differs between two boards anchored at the origin: the strip
+// right of the narrower one and the strip below the shorter one.
+static void damage_add_resize(struct damage *damage, int old_width,
+                              int old_height, int new_width, int new_height) {
+    int min_width = old_width < new_width ? old_width : new_width;
+    int max_width = old_width > new_width ? old_width : new_width;
+    int min_height = old_height < new_height ? old_height : new_height;
+    int max_height = old_height > new_height ? old_height : new_height;
+    damage_add(damage, min_width, 0, max_width - min_width, max_height);
+    damage_add(damage, 0, min_height, min_width, max_height - min_height);
+}
 
-    return fd;
+// Paints r of the slot: the board inside board_width x board_height and
+// transparent padding around it.
+static void paint_rect(int board_width, int board_height,
+                       const struct damage_rect *r) {
+    int x1 = r->x + r->width;
+    int y1 = r->y + r->height;
+    int board_x1 = x1 < board_width ? x1 : board_width;
+    int board_y1 = y1 < board_height ? y1 : board_height;
+    renderer_checker(renderer, r->x, r->y, board_x1 - r->x, board_y1 - r->y,
+                     first_color, second_color);
+    // keep the padding of an oversized buffer transparent
+    int pad_x = r->x > board_width ? r->x : board_width;
+    int pad_y = r->y > board_height ? r->y : board_height;
+    renderer_fill_rect(renderer, pad_x, r->y, x1 - pad_x, board_y1 - r->y, 0);
+    renderer_fill_rect(renderer, r->x, pad_y, r->width, y1 - pad_y, 0);
 }
 
-void resize() {
-    int fd = allocate_shm(width * height * 4);
-    if (fd < 0) {
-        return;
+void draw_chess_board(struct shm_slot *slot) {
+    struct board *board = &boards[slot - pool.slots];
+    int board_width = viewport ? slot->width : width;
+    int board_height = viewport ? slot->height : height;
+
+    TRACE_BEGIN("draw_chess_board");
+    shm_slot_begin_frame(slot, renderer);
+    // Redrawing the board is cheaper than flipping its colours in place:
+    // an XOR pass reads every pixel as well as writing it.
+    if (slot->fresh || board->first != first_color ||
+        board->second != second_color) {
+        struct damage_rect all = {0, 0, slot->width, slot->height};
+        paint_rect(board_width, board_height, &all);
+    } else {
+        // The board is anchored at the origin, so a slot painted at
+        // another size only needs the strips between the two.
+        struct damage stale;
+        damage_clear(&stale);
+        damage_add_resize(&stale, board->width, board->height, board_width,
+                          board_height);
+        for (int i = 0; i < stale.count; i++) {
+            paint_rect(board_width, board_height, &stale.rects[i]);
+        }
     }
-    shm_data = mmap(NULL, width * height * 4, PROT_READ | PROT_WRITE,
-                    MAP_SHARED, fd, 0);
+    renderer_end_frame(renderer);
+    board->first = first_color;
+    board->second = second_color;
+    board->width = board_width;
+    board->height = board_height;
+    TRACE_END("draw_chess_board");
+}
 
-    if (shm_data == MAP_FAILED) {
-        perror("mmap");
-        close(fd);
-        shm_data = NULL;
-        return;
-    }
+// Round up with a quarter of headroom so the next few configures of a
+// growing window still fit.
+static int pad_size(int size) {
+    return (size + size / 4 + 63) & ~63;
+}
 
-    struct wl_shm_pool *pool = wl_shm_create_pool(shm, fd, width * height * 4);
-    buffer = wl_shm_pool_create_buffer(pool, 0, width, height, width * 4,
-                                       WL_SHM_FORMAT_ARGB8888);
-    wl_shm_pool_destroy(pool);
-    pool = NULL;
-    close(fd);
+static void set_crop(void) {
+    wp_viewport_set_source(viewport, 0, 0, wl_fixed_from_int(width),
+                           wl_fixed_from_int(height));
+    wp_viewport_set_destination(viewport, width, height);
 }
 
-void invert_chess_board_colors() {
-    uint32_t tmp = first_color;
-    first_color = second_color;
-    second_color = tmp;
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
 }
 
-void draw_chess_board() {
-    uint32_t *pixels = (uint32_t *)shm_data;
-    for (int x = 0; x < width; x++) {
-        for (int y = 0; y < height; y++) {
-            if ((x + y / 8 * 8) % 16 < 8) {
-                pixels[y * width + x] = first_color;
-            } else {
-                pixels[y * width + x] = second_color;
+int draw(void *data) {
+    // memset(shm_data, color, width * height * 4);
+
+    if (damage_empty(&frame_damage)) {
+        // the attached buffer already shows the current board
+        wl_surface_commit(surface);
+        return 0;
+    }
+
+    if (viewport && live_resize && shown_slot) {
+        struct board *board = &boards[shown_slot - pool.slots];
+        if (board->width >= width && board->height >= height &&
+            board->first == first_color && board->second == second_color) {
+            // the attached board already covers the new size
+            uint64_t start = now_ns();
+            set_crop();
+            shown_width = width;
+            shown_height = height;
+            if ((first_color & second_color) >> 24 == 0xFF) {
+                opaque_region_set(&opaque, 0, 0, width, height);
             }
+            wl_surface_commit(surface);
+            damage_clear(&frame_damage);
+            latency_stats_add(&draw_times, now_ns() - start);
+            return 0;
         }
     }
-}
 
-void draw() {
-    // memset(shm_data, color, width * height * 4);
+    int buf_width = width;
+    int buf_height = height;
+    if (live_resize) {
+        buf_width = buffer_width >= width ? buffer_width : pad_size(width);
+        buf_height = buffer_height >= height ? buffer_height : pad_size(height);
+    }
+
+    // XRGB8888 cannot keep the padding of an oversized buffer transparent,
+    // which only matters when no viewport crops it away
+    int opaque_board = (first_color & second_color) >> 24 == 0xFF;
+    pool.format = shm_format_select(
+        opaque_board &&
+        (viewport || (buf_width == width && buf_height == height)));
+    struct shm_slot *slot = shm_pool_acquire(&pool, buf_width, buf_height);
+    if (!slot) {
+        // every buffer is still held by the compositor, commit anyway so
+        // the frame callback fires and try again then
+        wl_surface_commit(surface);
+        return -1;
+    }
+    buffer = slot->buffer;
+    shm_data = (uint8_t *)slot->data;
+
+    uint64_t start = now_ns();
+    draw_chess_board(slot);
+    // a slot brought up to date by strips alone says little about the
+    // whole, but the board is known: opaque wherever it is shown
+    if (opaque_board) {
+        opaque_region_set(&opaque, 0, 0, width, height);
+    } else {
+        opaque_region_set(&opaque, 0, 0, 0, 0);
+    }
 
-    draw_chess_board();
+    int resized = width != shown_width || height != shown_height;
+    if (resized && viewport) {
+        set_crop();
+        shown_width = width;
+        shown_height = height;
+    } else if (resized) {
+        // only the board is the window, the padding is neither part of
+        // the geometry nor clickable
+        struct wl_region *region = wl_compositor_create_region(compositor);
+        wl_region_add(region, 0, 0, width, height);
+        wl_surface_set_input_region(surface, region);
+        wl_region_destroy(region);
+        xdg_surface_set_window_geometry(xdg_surface, 0, 0, width, height);
+        shown_width = width;
+        shown_height = height;
+    }
+    // a resize within the same buffer is already damaged by the strips
+    // xdg_toplevel_configure() added
+    if (buf_width != buffer_width || buf_height != buffer_height) {
+        damage_add(&frame_damage, 0, 0, buf_width, buf_height);
+    }
+    buffer_width = buf_width;
+    buffer_height = buf_height;
+    shown_slot = slot;
 
     wl_surface_attach(surface, buffer, 0, 0);
-    wl_surface_damage_buffer(surface, 0, 0, width, height);
+    damage_submit(&frame_damage, surface);
+    TRACE_BEGIN("wl_surface_commit");
     wl_surface_commit(surface);
+    TRACE_END("wl_surface_commit");
+    damage_clear(&frame_damage);
+    latency_stats_add(&draw_times, now_ns() - start);
+    return 0;
 }
 
 void xdg_surface_configure(void *data, struct xdg_surface *xdg_surface,
                            uint32_t serial) {
+    TRACE_INSTANT("xdg_surface_configure");
     xdg_surface_ack_configure(xdg_surface, serial);
-    if (!shm_data) {
-        resize();
-    }
-    draw();
+    frame_scheduler_schedule(&scheduler);
 }
 
 struct xdg_surface_listener xdg_surface_listener = {
@@ -135,15 +298,36 @@ struct xdg_surface_listener xdg_surface_listener = {
 void xdg_toplevel_configure(void *data, struct xdg_toplevel *xdg_toplevel,
                             int32_t new_width, int32_t new_height,
                             struct wl_array *states) {
+    TRACE_INSTANT("xdg_toplevel_configure");
     if (new_width <= 0 || new_height <= 0) {
         return;
     }
 
     if (width != new_width || height != new_height) {
-        munmap(shm_data, width * height * 4);
+        damage_add_resize(&frame_damage, width, height, new_width,
+                          new_height);
         width = new_width;
         height = new_height;
-        resize();
+        if (shown_width && settle_timer) {
+            live_resize = 1;
+            event_source_timer_update(settle_timer, RESIZE_SETTLE_MS, 0);
+        }
+    }
+}
+
+void resize_settled(void *data, uint32_t expirations) {
+    TRACE_INSTANT("resize_settled");
+    live_resize = 0;
+    if (buffer_width != width || buffer_height != height) {
+        // the padded buffers are done with, give their memory back
+        int trimmed = shm_pool_trim(&pool, width, height);
+        if (trimmed < 0) {
+            log_warn("failed to trim the shm pool");
+        } else if (trimmed) {
+            shown_slot = NULL;
+        }
+        damage_add(&frame_damage, 0, 0, width, height);
+        frame_scheduler_schedule(&scheduler);
     }
 }
 
@@ -211,8 +395,10 @@ void pointer_motion(void *data, struct wl_pointer *wl_pointer, uint32_t time,
 void pointer_button(void *data, struct wl_pointer *wl_pointer, uint32_t serial,
                     uint32_t time, uint32_t button, uint32_t state) {
     if (state == WL_POINTER_BUTTON_STATE_PRESSED) {
-        printf("mouse clicked!!\n");
+        TRACE_INSTANT("pointer_button");
+        log_info("mouse clicked");
         invert_chess_board_colors();
+        frame_scheduler_schedule(&scheduler);
     }
 }
 
@@ -263,6 +449,7 @@ void registry_global(void *data, struct wl_registry *registry, uint32_t id,
             wl_registry_bind(registry, id, &wl_compositor_interface, 4);
     } else if (!strcmp(interface, wl_shm_interface.name)) {
         shm = wl_registry_bind(registry, id, &wl_shm_interface, 1);
+        shm_format_listen(shm);
     } else if (!strcmp(interface, xdg_wm_base_interface.name)) {
         xdg_wm_base = wl_registry_bind(registry, id, &xdg_wm_base_interface, 1);
         xdg_wm_base_add_listener(xdg_wm_base, &xdg_wm_base_listener, NULL);
@@ -272,12 +459,15 @@ void registry_global(void *data, struct wl_registry *registry, uint32_t id,
     } else if (!strcmp(interface, zxdg_exporter_v2_interface.name)) {
         exporter =
             wl_registry_bind(registry, id, &zxdg_exporter_v2_interface, 1);
+    } else if (!strcmp(interface, wp_viewporter_interface.name)) {
+        viewporter =
+            wl_registry_bind(registry, id, &wp_viewporter_interface, 1);
     }
 }
 
 void registry_global_remove(void *data, struct wl_registry *registry,
                             uint32_t id) {
-    printf("Global remove: %u\n", id);
+    log_info("Global remove: %u", id);
 }
 
 struct wl_registry_listener listener = {
@@ -301,18 +491,19 @@ void clean_up() {
         xdg_surface_destroy(xdg_surface);
         xdg_surface = NULL;
     }
+    frame_scheduler_finish(&scheduler);
+    if (viewport) {
+        wp_viewport_destroy(viewport);
+        viewport = NULL;
+    }
     if (surface) {
         wl_surface_destroy(surface);
         surface = NULL;
     }
-    if (buffer) {
-        wl_buffer_destroy(buffer);
-        buffer = NULL;
-    }
-    if (shm_data) {
-        munmap(shm_data, width * height * 4);
-        shm_data = NULL;
-    }
+    shm_pool_finish(&pool);
+    shown_slot = NULL;
+    buffer = NULL;
+    shm_data = NULL;
     if (keyboard) {
         wl_keyboard_destroy(keyboard);
         keyboard = NULL;
@@ -329,6 +520,10 @@ void clean_up() {
         zxdg_exporter_v2_destroy(exporter);
         exporter = NULL;
     }
+    if (viewporter) {
+        wp_viewporter_destroy(viewporter);
+        viewporter = NULL;
+    }
     if (exported_handle) {
         free(exported_handle);
         exported_handle = NULL;
@@ -337,7 +532,12 @@ void clean_up() {
 
 void window_init() {
     surface = wl_compositor_create_surface(compositor);
-    
+    frame_scheduler_init(&scheduler, surface, draw, NULL);
+    opaque_region_init(&opaque, compositor, surface);
+    if (viewporter && solid_surface_use_viewport()) {
+        viewport = wp_viewporter_get_viewport(viewporter, surface);
+    }
+
     xdg_surface = xdg_wm_base_get_xdg_surface(xdg_wm_base, surface);
     xdg_surface_add_listener(xdg_surface, &xdg_surface_listener, NULL);
 
@@ -347,14 +547,46 @@ void window_init() {
 
 }
 
-void handle_sigint(int sig) {
-    printf("Received signal %d, cleaning up...\n", sig);
+// Alternates colour swaps with client-chosen resizes, standing in for the
+// clicks and interactive resizes a headless compositor never sends.
+void script_step_func(void *data, uint32_t expirations) {
+    if (script_step++ == script_steps) {
+        close_flag = 1;
+        return;
+    }
+    if (script_step % 4 == 0) {
+        xdg_toplevel_configure(NULL, toplevel, 400 + (script_step * 37) % 400,
+                               400 + (script_step * 53) % 400, NULL);
+    } else {
+        invert_chess_board_colors();
+    }
+    frame_scheduler_schedule(&scheduler);
+}
+
+void handle_signal(void *data, uint32_t sig) {
+    log_info("Received signal %d, cleaning up...", sig);
     close_flag = 1;
 }
 
-int main() {
-    signal(SIGINT, handle_sigint);
-    signal(SIGTERM, handle_sigint);
+// Usage: exporter [steps [interval_ms]]
+// With a step count the exporter redraws on its own every interval_ms
+// (default 4) and exits after that many steps, printing its draw times.
+int main(int argc, char **argv) {
+    script_steps = argc > 1 ? atoi(argv[1]) : 0;
+    int script_interval_ms = argc > 2 ? atoi(argv[2]) : 4;
+    if (script_steps < 0 || script_interval_ms <= 0) {
+        fprintf(stderr, "Usage: %s [steps [interval_ms]]\n", argv[0]);
+        return -1;
+    }
+    latency_stats_init(&draw_times);
+    log_init();
+    TRACE_INIT();
+    tile_render_init(0);
+    renderer = renderer_create(NULL);
+    if (!renderer) {
+        return -1;
+    }
+
     struct wl_display *display = wl_display_connect(NULL);
     if (display == NULL) {
         printf("Failed to connect to Wayland display\n");
@@ -363,6 +595,8 @@ int main() {
     struct wl_registry *registry = wl_display_get_registry(display);
     wl_registry_add_listener(registry, &listener, NULL);
     wl_display_roundtrip(display);
+    shm_pool_init(&pool, shm, 3);
+    damage_add(&frame_damage, 0, 0, width, height);
 
     window_init();
     exported = zxdg_exporter_v2_export_toplevel(exporter, surface);
@@ -370,21 +604,47 @@ int main() {
 
     wl_surface_commit(surface);
 
-    while (wl_display_dispatch(display)) {
-        if (close_flag) {
-            break;
-        }
+    if (event_loop_init(&loop, display, NULL) < 0) {
+        return -1;
+    }
+    struct event_source *sigint =
+        event_loop_add_signal(&loop, SIGINT, handle_signal, NULL);
+    struct event_source *sigterm =
+        event_loop_add_signal(&loop, SIGTERM, handle_signal, NULL);
+    settle_timer = event_loop_add_timer(&loop, resize_settled, NULL);
+    if (script_steps) {
+        script_timer = event_loop_add_timer(&loop, script_step_func, NULL);
+        event_source_timer_update(script_timer, script_interval_ms,
+                                  script_interval_ms);
+    }
+
+    while (!close_flag && event_loop_dispatch(&loop, -1) == 0) {
+    }
+    if (script_timer) {
+        event_source_remove(script_timer);
     }
+    event_source_remove(settle_timer);
+    event_source_remove(sigint);
+    event_source_remove(sigterm);
+    event_loop_finish(&loop);
     wl_display_roundtrip(display);
     if (surface && buffer) {
         wl_surface_attach(surface, NULL, 0, 0);
         wl_surface_commit(surface);
         wl_display_roundtrip(display);
     }
+    shm_alloc_print_stats(stdout);
     clean_up();
+    latency_stats_print(&draw_times, stdout, "draw");
+    frame_scheduler_print_stats(&scheduler, stdout, "draw");
+    latency_stats_finish(&draw_times);
     wl_registry_destroy(registry);
     wl_display_disconnect(display);
     printf("reached the end of exporter.\n");
     fflush(stdout);
+    renderer_destroy(renderer);
+    tile_render_finish();
+    TRACE_FINISH();
+    log_finish();
     return 0;
 }
\ No newline at end of file
@@ -7,7 +7,9 @@
 #include <wayland-client.h>
 
 #include "xdg-foreign-unstable-v2-client-protocol.h"
-#include "xdg-shell-client-header.h"
+#include "xdg-shell-client-protocol.h"
+#include "log.h"
+#include "shm-pool.h"
 
 struct app_state {
     struct wl_compositor *compositor;
@@ -15,6 +17,7 @@ struct app_state {
     struct zxdg_importer_v2 *importer;
     struct zxdg_imported_v2 *imported;
     struct wl_shm *shm;
+    struct shm_pool pool;
 
     struct wl_surface *surface;
     struct xdg_surface *xdg_surface;
@@ -38,37 +41,16 @@ static const struct xdg_wm_base_listener wm_base_listener = {
 int create_shm_buffer(struct app_state *state) {
     state->width = 400;
     state->height = 400;
-    int stride = state->width * 4;
-    int size = stride * state->height;
 
-    int fd = shm_open("/myshm", O_CREAT | O_RDWR, 0600);
-    shm_unlink("/myshm");
-    if (fd < 0) {
-        perror("shm_open");
+    struct shm_slot *slot =
+        shm_pool_acquire(&state->pool, state->width, state->height);
+    if (!slot) {
         return -1;
     }
+    state->buffer = slot->buffer;
+    state->shm_data = (uint8_t *)slot->data;
 
-    if (ftruncate(fd, size) < 0) {
-        perror("ftruncate");
-        close(fd);
-        return -1;
-    }
-
-    state->shm_data =
-        mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    if (state->shm_data == MAP_FAILED) {
-        perror("mmap");
-        close(fd);
-        return -1;
-    }
-
-    struct wl_shm_pool *pool = wl_shm_create_pool(state->shm, fd, size);
-    state->buffer = wl_shm_pool_create_buffer(
-        pool, 0, state->width, state->height, stride, WL_SHM_FORMAT_ARGB8888);
-    wl_shm_pool_destroy(pool);
-    close(fd);
-
-    memset(state->shm_data, 0xFF, size);
+    memset(state->shm_data, 0xFF, slot->stride * slot->height);
     return 0;
 }
 
@@ -81,7 +63,7 @@ void xdg_surface_configure(void *data, struct xdg_surface *surface,
         state->configured = 1;
 
         if (create_shm_buffer(state) < 0) {
-            fprintf(stderr, "Failed to create SHM buffer\n");
+            log_error("Failed to create SHM buffer");
             return;
         }
         wl_surface_attach(state->surface, state->buffer, 0, 0);
@@ -143,7 +125,7 @@ static void registry_global(void *data, struct wl_registry *registry,
                             uint32_t name, const char *interface,
                             uint32_t version) {
     struct app_state *state = data;
-    printf("%s\n", interface);
+    log_debug("global %s", interface);
     if (strcmp(interface, wl_compositor_interface.name) == 0) {
         state->compositor =
             wl_registry_bind(registry, name, &wl_compositor_interface, 4);
@@ -170,6 +152,7 @@ int main(int argc, char **argv) {
 
     struct app_state state = {0};
     state.running = 1;
+    log_init();
 
     struct wl_display *display = wl_display_connect(NULL);
     if (!display) {
@@ -189,6 +172,7 @@ int main(int argc, char **argv) {
         fprintf(stderr, "Missing required Wayland globals\n");
         return 1;
     }
+    shm_pool_init(&state.pool, state.shm, 1);
 
     create_window(&state, argv[1]);
 
@@ -207,12 +191,7 @@ int main(int argc, char **argv) {
     if (state.surface) {
         wl_surface_destroy(state.surface);
     }
-    if (state.buffer) {
-        wl_buffer_destroy(state.buffer);
-    }
-    if (state.shm_data) {
-        munmap(state.shm_data, state.width * state.height * 4);
-    }
+    shm_pool_finish(&state.pool);
 
     if (state.importer) zxdg_importer_v2_destroy(state.importer);
     if (state.wm_base) xdg_wm_base_destroy(state.wm_base);
@@ -221,5 +200,6 @@ int main(int argc, char **argv) {
 
     wl_registry_destroy(registry);
     wl_display_disconnect(display);
+    log_finish();
     return 0;
 }
\ No newline at end of file